@@ -1,15 +1,14 @@
 #include <signal.h>
+#include <poll.h>
 #include <iostream>
 #include <iomanip>
-#include <thread>
 #include <chrono>  // is already included by VitoWiFi
+#include <algorithm>
 #include <VitoWiFi.h>
 
 VitoWiFi::VitoWiFi<VitoWiFi::VS2> vitoWiFi("/dev/ttyUSB0");
 
 bool exitProgram = false;
-bool readValues = false;
-uint8_t datapointIndex = 0;
 
 VitoWiFi::Datapoint datapoints[] = {
   VitoWiFi::Datapoint("outsidetemp", 0x5525, 2, VitoWiFi::div10),
@@ -17,6 +16,8 @@ VitoWiFi::Datapoint datapoints[] = {
   VitoWiFi::Datapoint("pump", 0x2906, 1, VitoWiFi::noconv)
 };
 
+VitoWiFi::Poller<VitoWiFi::VS2, 3> poller(&vitoWiFi);
+
 void signalHandler(int signum) {
    std::cout << "Caught signal " << signum << std::endl;
    exitProgram = true;
@@ -68,30 +69,19 @@ void setup() {
 
   vitoWiFi.onResponse(onResponse);
   vitoWiFi.onError(onError);
+  vitoWiFi.setRunToCompletion(true);  // drive a transaction as far as possible on every loop()
   vitoWiFi.begin();
 
+  // every datapoint has its own interval
+  poller.add(datapoints[0], 300000UL);  // outsidetemp every 5 minutes
+  poller.add(datapoints[1], 10000UL);   // boilertemp every 10 seconds
+  poller.add(datapoints[2], 60000UL);   // pump every minute
+
   std::cout << "Setup finished" << std::endl;
 }
 
 void loop() {
-  static uint32_t lastMillis = 0;
-  if (vw_millis() - lastMillis > 60000UL) {  // read all values every 60 seconds
-    std::cout << "reading datapoints" << std::endl;
-    lastMillis = vw_millis();
-    readValues = true;
-    datapointIndex = 0;
-  }
-
-  if (readValues) {
-    if (vitoWiFi.read(datapoints[datapointIndex])) {
-      std::cout << "datapoint \"" << datapoints[datapointIndex].name() << "\" requested" << std::endl;
-      ++datapointIndex;
-    }
-    if (datapointIndex == 3) {
-      readValues = false;
-    }
-  }
-
+  poller.loop();
   vitoWiFi.loop();
 }
 
@@ -100,7 +90,12 @@ int main() {
   setup();
   while(1) {
     loop();
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // wait for data from the adapter or until VitoWiFi or the poller has something to do
+    // the poller only submits when VitoWiFi is idle
+    uint32_t timeout = std::min<uint32_t>(vitoWiFi.nextTimeout(), 1000);
+    if (!vitoWiFi.isBusy()) timeout = std::min(timeout, poller.nextDue());
+    struct pollfd pfd = {vitoWiFi.fd(), POLLIN, 0};
+    poll(&pfd, 1, static_cast<int>(timeout));
     if (exitProgram) break;
   }
   vitoWiFi.end();
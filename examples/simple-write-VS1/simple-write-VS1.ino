@@ -35,6 +35,12 @@ void setRoomTemp(uint8_t value) {
 }
 
 void onResponse(const uint8_t* data, uint8_t length, const VitoWiFi::Datapoint& request) {
+  // a write is confirmed with an empty response
+  if (length == 0) {
+    SERIAL2.printf("%s written\n", request.name());
+    return;
+  }
+
   // raw data can be accessed through the 'response' argument
   SERIAL2.print("Raw data received:");
   for (uint8_t i = 0; i < length; ++i) {
@@ -0,0 +1,145 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include "Constants.h"
+#include "Helpers.h"
+#include "Listener.h"
+#include "Datapoint/Datapoint.h"
+#include "VS2/PacketVS2.h"
+
+namespace VitoWiFi {
+
+/*
+Only calls onResponse when the value of a datapoint changed since the
+previous notification. Datapoints are either compared byte by byte or,
+for datapoints with a div10, div2 or div3600 converter, with a deadband
+on the decoded value. Unregistered datapoints are passed through.
+
+Filters the responses of any source: VitoWiFi itself, or a component such
+as the ReadPlanner or ResponseCache to filter what they pass on.
+
+VS1 and GWG don't tell read and write responses apart so write responses
+of registered datapoints are filtered too.
+Datapoints longer than MAX_LENGTH bytes can't be registered.
+*/
+template <class PROTOCOLVERSION, std::size_t SIZE, std::size_t MAX_LENGTH = 8>
+class ChangeFilter : public Source<PROTOCOLVERSION>, private Listener {
+  static_assert(SIZE > 0 && SIZE < 256, "ChangeFilter size has to be between 1 and 255");
+
+ public:
+  explicit ChangeFilter(Source<PROTOCOLVERSION>* source)
+  : _source(source)
+  , _entries()
+  , _numEntries(0)
+  , _suppressed(0) {
+    _source->addListener(this);
+  }
+  ~ChangeFilter() {
+    _source->removeListener(this);
+  }
+  ChangeFilter(const ChangeFilter&) = delete;
+  ChangeFilter & operator=(const ChangeFilter&) = delete;
+
+  // Notifies when any byte changed. Returns false when full or when too long.
+  bool add(const Datapoint& datapoint) {
+    if (_numEntries == SIZE || !datapoint || datapoint.length() > MAX_LENGTH) return false;
+    Entry& entry = _entries[_numEntries++];
+    entry.address = datapoint.address();
+    entry.length = datapoint.length();
+    entry.deadband = 0;
+    entry.useDeadband = false;
+    entry.valid = false;
+    return true;
+  }
+
+  // Notifies when the decoded value moved at least deadband away from the last notified value.
+  // Returns false when full or when the converter doesn't decode to a float.
+  bool add(const Datapoint& datapoint, float deadband) {
+    const Converter* converter = &datapoint.converter();
+    if (converter != &div10 && converter != &div2 && converter != &div3600) return false;
+    if (!add(datapoint)) return false;
+    Entry& entry = _entries[_numEntries - 1];
+    entry.deadband = deadband;
+    entry.useDeadband = true;
+    return true;
+  }
+
+  // The next response of every datapoint is notified.
+  void reset() {
+    for (std::size_t i = 0; i < _numEntries; ++i) {
+      _entries[i].valid = false;
+    }
+  }
+
+  // Number of responses that were swallowed because nothing changed.
+  uint32_t suppressed() const {
+    return _suppressed;
+  }
+
+ private:
+  struct Entry {
+    uint16_t address;
+    uint8_t length;
+    bool useDeadband;
+    bool valid;
+    float deadband;
+    float value;
+    uint8_t data[MAX_LENGTH];
+  };
+
+  Source<PROTOCOLVERSION>* _source;
+  Entry _entries[SIZE];
+  std::size_t _numEntries;
+  uint32_t _suppressed;
+
+  void handleResponse(const PacketVS2& response, const Datapoint& request) override {
+    if (response.functionCode() == FunctionCode::READ && !_changed(request, response.data(), response.dataLength())) return;
+    this->_emitResponse(response, request);
+  }
+
+  void handleResponse(const uint8_t* data, uint8_t length, const Datapoint& request) override {
+    if (!_changed(request, data, length)) return;
+    this->_emitResponse(data, length, request);
+  }
+
+  void handleError(OptolinkResult error, const Datapoint& request) override {
+    this->_emitError(error, request);
+  }
+
+  // updates the stored value when changed, counts when not
+  bool _changed(const Datapoint& request, const uint8_t* data, uint8_t length) {
+    std::size_t index = VitoWiFiInternals::indexOf(_entries, _numEntries, request);
+    if (index == _numEntries || !data || length != _entries[index].length) return true;
+    Entry* entry = &_entries[index];
+    if (entry->useDeadband) {
+      float value = request.decode(data, length);
+      float delta = value > entry->value ? value - entry->value : entry->value - value;
+      if (entry->valid && delta < entry->deadband) {
+        ++_suppressed;
+        return false;
+      }
+      entry->value = value;
+    } else {
+      if (entry->valid && std::memcmp(entry->data, data, length) == 0) {
+        ++_suppressed;
+        return false;
+      }
+      std::memcpy(entry->data, data, length);
+    }
+    entry->valid = true;
+    return true;
+  }
+};
+
+}  // end namespace VitoWiFi
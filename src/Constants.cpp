@@ -21,6 +21,10 @@ const char* errorToString(OptolinkResult error) {
     return "crc";
   } else if (error == VitoWiFi::OptolinkResult::ERROR) {
     return "error";
+  } else if (error == VitoWiFi::OptolinkResult::SUPERSEDED) {
+    return "superseded";
+  } else if (error == VitoWiFi::OptolinkResult::CANCELLED) {
+    return "cancelled";
   }
   return "invaled error";
 }
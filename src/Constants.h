@@ -15,9 +15,31 @@ the LICENSE file.
 #define VW_START_PAYLOAD_LENGTH 10
 #endif
 
+// #define VW_STATIC_PAYLOAD_LENGTH 255
+
+#ifndef VW_QUEUE_SIZE
+#define VW_QUEUE_SIZE 8
+#endif
+
+#ifndef VW_MAX_IN_FLIGHT
+#define VW_MAX_IN_FLIGHT 1
+#endif
+
+#ifndef VW_QUEUE_PAYLOAD_LENGTH
+#define VW_QUEUE_PAYLOAD_LENGTH VW_START_PAYLOAD_LENGTH
+#endif
+
 namespace VitoWiFi {
 
 constexpr size_t START_PAYLOAD_LENGTH = VW_START_PAYLOAD_LENGTH;
+constexpr size_t QUEUE_SIZE = VW_QUEUE_SIZE;
+constexpr size_t QUEUE_PAYLOAD_LENGTH = VW_QUEUE_PAYLOAD_LENGTH;
+constexpr size_t MAX_IN_FLIGHT = VW_MAX_IN_FLIGHT;
+#if defined(VW_STATIC_PAYLOAD_LENGTH)
+constexpr size_t STATIC_PAYLOAD_LENGTH = VW_STATIC_PAYLOAD_LENGTH;
+static_assert(STATIC_PAYLOAD_LENGTH > 0 && STATIC_PAYLOAD_LENGTH < 256, "VW_STATIC_PAYLOAD_LENGTH has to be between 1 and 255");
+#endif
+static_assert(MAX_IN_FLIGHT > 0 && MAX_IN_FLIGHT < 8, "VW_MAX_IN_FLIGHT has to be between 1 and 7");
 
 enum class FunctionCode : uint8_t {
   READ  = 0x01,
@@ -49,11 +71,22 @@ enum class OptolinkResult {
   LENGTH,
   NACK,
   CRC,
-  ERROR
+  ERROR,
+  SUPERSEDED,
+  CANCELLED
 };
+constexpr size_t NUMBER_OF_RESULTS = static_cast<size_t>(OptolinkResult::CANCELLED) + 1;
 
 const char* errorToString(OptolinkResult error);
 
+// Request classes, highest priority first. Each class has its own queue.
+enum class Priority : uint8_t {
+  INTERACTIVE_WRITE,
+  INTERACTIVE_READ,
+  BACKGROUND
+};
+constexpr size_t NUMBER_OF_PRIORITIES = 3;
+
 }  // end namespace VitoWiFi
 
 namespace VitoWiFiInternals {
@@ -8,6 +8,8 @@ the LICENSE file.
 
 #include "GWG.h"
 
+#include <cstring>
+
 namespace VitoWiFi {
 
 #if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_ESP32)
@@ -17,24 +19,27 @@ GWG::GWG(HardwareSerial* interface)
 , _lastMillis(_currentMillis)
 , _requestTime(0)
 , _bytesTransferred(0)
+, _isWrite(false)
 , _interface(nullptr)
 , _currentDatapoint(Datapoint(nullptr, 0x0000, 0, VitoWiFi::noconv))
 , _currentRequest()
+, _queue()
 , _responseBuffer(nullptr)
 , _allocatedLength(0)
 , _onResponseCallback(nullptr)
-, _onErrorCallback(nullptr) {
+, _onErrorCallback(nullptr)
+, _metrics()
+, _stateSince(_currentMillis)
+, _synced(false)
+, _latencyRecorder(nullptr)
+, _times() {
   assert(interface != nullptr);
   _interface = new(std::nothrow) VitoWiFiInternals::HardwareSerialInterface(interface);
   if (!_interface) {
     vw_log_e("Could not create serial interface");
     vw_abort();
   }
-  _responseBuffer = reinterpret_cast<uint8_t*>(malloc(START_PAYLOAD_LENGTH));
-  if (!_responseBuffer) {
-    vw_log_e("Could not create response buffer");
-    vw_abort();
-  }
+  _createResponseBuffer();
 }
 
 #if defined(ARDUINO_ARCH_ESP8266)
@@ -44,24 +49,27 @@ GWG::GWG(SoftwareSerial* interface)
 , _lastMillis(_currentMillis)
 , _requestTime(0)
 , _bytesTransferred(0)
+, _isWrite(false)
 , _interface(nullptr)
 , _currentDatapoint(Datapoint(nullptr, 0x0000, 0, VitoWiFi::noconv))
 , _currentRequest()
+, _queue()
 , _responseBuffer(nullptr)
 , _allocatedLength(0)
 , _onResponseCallback(nullptr)
-, _onErrorCallback(nullptr) {
+, _onErrorCallback(nullptr)
+, _metrics()
+, _stateSince(_currentMillis)
+, _synced(false)
+, _latencyRecorder(nullptr)
+, _times() {
   assert(interface != nullptr);
   _interface = new(std::nothrow) VitoWiFiInternals::SoftwareSerialInterface(interface);
   if (!_interface) {
     vw_log_e("Could not create serial interface");
     vw_abort();
   }
-  _responseBuffer = reinterpret_cast<uint8_t*>(malloc(START_PAYLOAD_LENGTH));
-  if (!_responseBuffer) {
-    vw_log_e("Could not create response buffer");
-    vw_abort();
-  }
+  _createResponseBuffer();
 }
 #endif
 
@@ -72,30 +80,35 @@ GWG::GWG(const char* interface)
 , _lastMillis(_currentMillis)
 , _requestTime(0)
 , _bytesTransferred(0)
+, _isWrite(false)
 , _interface(nullptr)
 , _currentDatapoint(Datapoint(nullptr, 0x0000, 0, VitoWiFi::noconv))
 , _currentRequest()
+, _queue()
 , _responseBuffer(nullptr)
 , _allocatedLength(0)
 , _onResponseCallback(nullptr)
-, _onErrorCallback(nullptr) {
+, _onErrorCallback(nullptr)
+, _metrics()
+, _stateSince(_currentMillis)
+, _synced(false)
+, _latencyRecorder(nullptr)
+, _times() {
   assert(interface != nullptr);
   _interface = new(std::nothrow) VitoWiFiInternals::LinuxSerialInterface(interface);
   if (!_interface) {
     vw_log_e("Could not create serial interface");
     vw_abort();
   }
-  _responseBuffer = reinterpret_cast<uint8_t*>(malloc(START_PAYLOAD_LENGTH));
-  if (!_responseBuffer) {
-    vw_log_e("Could not create response buffer");
-    vw_abort();
-  }
+  _createResponseBuffer();
 }
 #endif
 
 GWG::~GWG() {
   delete _interface;
+  #if !defined(VW_STATIC_PAYLOAD_LENGTH)
   free(_responseBuffer);
+  #endif
 }
 
 void GWG::onResponse(OnResponseCallback callback) {
@@ -105,64 +118,49 @@ void GWG::onError(OnErrorCallback callback) {
   _onErrorCallback = callback;
 }
 
-bool GWG::read(const Datapoint& datapoint) {
-  if (_currentDatapoint) {
+bool GWG::read(const Datapoint& datapoint, Priority priority) {
+  if (datapoint.length() == 0) {
+    vw_log_i("reading not possible, length error");
     return false;
   }
-  if (_currentRequest.createPacket(PacketGWGType.READ,
-                                   datapoint.address(),
-                                   datapoint.length()) &&
-      _expandResponseBuffer(datapoint.length())) {
-    _currentDatapoint = datapoint;
-    _requestTime = _currentMillis;
-    vw_log_i("reading packet OK");
-    return true;
+  VitoWiFiInternals::Request* request = _queue.acquire(priority);
+  if (!request) {
+    vw_log_i("reading not possible, queue full");
+    return false;
   }
-  vw_log_i("reading not possible, packet creation error");
-  return false;
+  request->datapoint = datapoint;
+  request->functionCode = FunctionCode::READ;
+  vw_log_i("reading packet OK");
+  return true;
 }
 
-bool GWG::write(const Datapoint& datapoint, const VariantValue& value) {
-  if (_currentDatapoint) {
-    return false;
-  }
-  uint8_t* payload = reinterpret_cast<uint8_t*>(malloc(datapoint.length()));
-  if (!payload) return false;
-  datapoint.encode(payload, datapoint.length(), value);
-  bool result = write(datapoint, payload, datapoint.length());
-  free(payload);
-  return result;
+bool GWG::write(const Datapoint& datapoint, const VariantValue& value, Priority priority) {
+  // encode straight into the queue slot
+  VitoWiFiInternals::Request* request = _acquireWrite(datapoint, datapoint.length(), priority);
+  if (!request) return false;
+  datapoint.encode(request->data, datapoint.length(), value);
+  return true;
 }
 
-bool GWG::write(const Datapoint& datapoint, const uint8_t* data, uint8_t length) {
-  if (_currentDatapoint) {
-    return false;
-  }
-  if (length != datapoint.length()) {
-    vw_log_i("writing not possible, length mismatch");
-    return false;
-  }
-  if (_currentRequest.createPacket(PacketGWGType.WRITE,
-                                   datapoint.address(),
-                                   datapoint.length(),
-                                   data) &&
-      _expandResponseBuffer(datapoint.length())) {
-    _currentDatapoint = datapoint;
-    _requestTime = _currentMillis;
-    vw_log_i("writing packet OK");
-    return true;
-  }
-  vw_log_i("writing not possible, packet creation error");
-  return false;
+bool GWG::write(const Datapoint& datapoint, const uint8_t* data, uint8_t length, Priority priority) {
+  VitoWiFiInternals::Request* request = _acquireWrite(datapoint, length, priority);
+  if (!request) return false;
+  std::memcpy(request->data, data, length);
+  return true;
 }
 
 bool GWG::begin() {
+  _currentMillis = vw_millis();
+  _synced = false;
   _setState(State::INIT);
   return _interface->begin();
 }
 
 void GWG::loop() {
   _currentMillis = vw_millis();
+  if (!_currentDatapoint) {
+    _nextRequest();
+  }
   switch (_state) {
   case State::INIT:
     _init();
@@ -179,6 +177,7 @@ void GWG::loop() {
   }
   // double timeout to accomodate for connection initialization
   if (_currentDatapoint && _currentMillis - _requestTime > 3000UL) {
+    _synced = false;
     _setState(State::INIT);
     _tryOnError(OptolinkResult::TIMEOUT);
   }
@@ -187,7 +186,20 @@ void GWG::loop() {
 void GWG::end() {
   _interface->end();
   _setState(State::UNDEFINED);
-  _currentDatapoint = Datapoint(nullptr, 0x0000, 0, VitoWiFi::noconv);
+  if (_currentDatapoint) {
+    _tryOnError(OptolinkResult::CANCELLED);  // clears _currentDatapoint
+  }
+  // callers of dropped requests still get an answer, requests queued from these callbacks stay queued
+  for (std::size_t n = _queue.size(); n > 0; --n) {
+    VitoWiFiInternals::Request& request = _queue.front();
+    Datapoint datapoint = request.datapoint;
+    uint8_t superseded = request.superseded;
+    _queue.drop();
+    for (uint8_t i = 0; i < superseded; ++i) {
+      _tryOnError(OptolinkResult::SUPERSEDED, datapoint);
+    }
+    _tryOnError(OptolinkResult::CANCELLED, datapoint);
+  }
 }
 
 int GWG::getState() const {
@@ -195,20 +207,115 @@ int GWG::getState() const {
 }
 
 bool GWG::isBusy() const {
-  if (_currentDatapoint) {
+  if (_currentDatapoint || !_queue.empty()) {
     return true;
   }
   return false;
 }
 
+const QueueStats& GWG::queueStats(Priority priority) const {
+  return _queue.stats(priority);
+}
+
+// a copy of the counters, time in the current state is included up to now
+LinkMetrics GWG::metrics() const {
+  LinkMetrics snapshot = _metrics;
+  snapshot.stateTime[static_cast<std::size_t>(_state)] += vw_millis() - _stateSince;
+  return snapshot;
+}
+
+void GWG::setLatencyRecorder(LatencyRecorder* recorder) {
+  _latencyRecorder = recorder;
+}
+
+int GWG::fd() const {
+  return _interface->fd();
+}
+
+// 0 when loop() can make progress right away, UINT32_MAX when only incoming data can
+uint32_t GWG::nextTimeout() const {
+  uint32_t now = vw_millis();
+  switch (_state) {
+  case State::INIT:
+  case State::RECEIVE:
+    break;
+  case State::UNDEFINED:
+    return UINT32_MAX;
+  default:
+    return 0;  // sending
+  }
+  if (_interface->pending() > 0) return 0;
+  if (!_currentDatapoint && !_queue.empty()) return 0;
+  if (_currentDatapoint) return VitoWiFiInternals::timeLeft(now, _requestTime, 3000UL);
+  return UINT32_MAX;
+}
+
 void GWG::_setState(State state) {
+  static_assert(static_cast<std::size_t>(State::UNDEFINED) < MAX_LINK_STATES, "LinkMetrics can't hold all states");
   vw_log_i("state %i --> %i", static_cast<std::underlying_type<State>::type>(_state), static_cast<std::underlying_type<State>::type>(state));
+  _metrics.stateTime[static_cast<std::size_t>(_state)] += _currentMillis - _stateSince;
+  _stateSince = _currentMillis;
   _state = state;
 }
 
+VitoWiFiInternals::Request* GWG::_acquireWrite(const Datapoint& datapoint, uint8_t length, Priority priority) {
+  if (length == 0 || length != datapoint.length() || length > QUEUE_PAYLOAD_LENGTH) {
+    vw_log_i("writing not possible, length error");
+    return nullptr;
+  }
+  VitoWiFiInternals::Request* request = _queue.acquireWrite(datapoint, priority);
+  if (!request) {
+    vw_log_i("writing not possible, queue full");
+    return nullptr;
+  }
+  request->datapoint = datapoint;
+  request->functionCode = FunctionCode::WRITE;
+  vw_log_i("writing packet OK");
+  return request;
+}
+
+std::size_t GWG::_write(const uint8_t* data, uint8_t length) {
+  std::size_t written = _interface->write(data, length);
+  _metrics.bytesSent += written;
+  return written;
+}
+
+// pop requests from the queue until one is turned into a packet
+bool GWG::_nextRequest() {
+  while (!_queue.empty()) {
+    VitoWiFiInternals::Request& request = _queue.front();
+    bool isWrite = request.functionCode == FunctionCode::WRITE;
+    bool created = _currentRequest.createPacket(isWrite ? PacketGWGType.WRITE : PacketGWGType.READ,
+                                                request.datapoint.address(),
+                                                request.datapoint.length(),
+                                                isWrite ? request.data : nullptr) &&
+                   _expandResponseBuffer(request.datapoint.length());
+    _currentDatapoint = request.datapoint;
+    _isWrite = isWrite;
+    uint8_t superseded = request.superseded;
+    _times.set(VitoWiFiInternals::RequestTimes::ENQUEUED, request.enqueueTime);
+    _times.set(VitoWiFiInternals::RequestTimes::DISPATCHED, _currentMillis);
+    _queue.pop();
+    for (uint8_t i = 0; i < superseded; ++i) {
+      _tryOnError(OptolinkResult::SUPERSEDED, _currentDatapoint);
+    }
+    if (created) {
+      _requestTime = _currentMillis;
+      return true;
+    }
+    vw_log_i("packet creation error");
+    _tryOnError(OptolinkResult::ERROR);  // clears _currentDatapoint
+  }
+  return false;
+}
+
 void GWG::_init() {
   if (_interface->available()) {
+    ++_metrics.bytesReceived;
     if (_interface->read() == VitoWiFiInternals::ProtocolBytes.ENQ && _currentDatapoint) {
+      // every transaction starts after an ENQ, only count the first one
+      if (!_synced) ++_metrics.inits;
+      _synced = true;
       _bytesTransferred = 0;
       _setState(State::SEND);
     }
@@ -216,47 +323,87 @@ void GWG::_init() {
 }
 
 void GWG::_send() {
-  _bytesTransferred += _interface->write(&_currentRequest[_bytesTransferred], _currentRequest.length() - _bytesTransferred);
+  _bytesTransferred += _write(&_currentRequest[_bytesTransferred], _currentRequest.length() - _bytesTransferred);
   if (_bytesTransferred == _currentRequest.length()) {
     _bytesTransferred = 0;
     _lastMillis = _currentMillis;
+    _times.set(VitoWiFiInternals::RequestTimes::SENT, _currentMillis);
     _setState(State::RECEIVE);
   }
 }
 
 void GWG::_receive() {
-  while (_interface->available()) {
-    _responseBuffer[_bytesTransferred] = _interface->read();
-    ++_bytesTransferred;
+  uint8_t length = _isWrite ? 1 : _currentDatapoint.length();
+  std::size_t received = _interface->read(&_responseBuffer[_bytesTransferred], length - _bytesTransferred);
+  if (received > 0) {
+    if (_bytesTransferred == 0) _times.set(VitoWiFiInternals::RequestTimes::RESPONDED, _currentMillis);
+    _metrics.bytesReceived += received;
+    _bytesTransferred += received;
     _lastMillis = _currentMillis;
   }
-  if (_bytesTransferred == _currentRequest.length()) {
+  if (_bytesTransferred == length) {
+    _bytesTransferred = 0;
     _setState(State::INIT);
     _tryOnResponse();
   }
 }
 
+// a write is confirmed with 0x00 and completes with an empty response
 void GWG::_tryOnResponse() {
+  if (_isWrite && _responseBuffer[0] != 0x00) {
+    vw_log_w("Write rejected: 0x%02x", _responseBuffer[0]);
+    _tryOnError(OptolinkResult::ERROR);
+    return;
+  }
+  ++_metrics.results[static_cast<std::size_t>(OptolinkResult::PACKET)];
+  VitoWiFiInternals::recordLatency(_latencyRecorder, _currentDatapoint.address(), _times, _currentMillis, OptolinkResult::PACKET);
   if (_onResponseCallback) {
-    _onResponseCallback(_responseBuffer, _currentRequest.length(), _currentDatapoint);
+    _onResponseCallback(_responseBuffer, _isWrite ? 0 : _currentDatapoint.length(), _currentDatapoint);
   }
+  _currentDatapoint = Datapoint(nullptr, 0, 0, noconv);
 }
 
 void GWG::_tryOnError(OptolinkResult result) {
+  VitoWiFiInternals::recordLatency(_latencyRecorder, _currentDatapoint.address(), _times, _currentMillis, result);
+  _tryOnError(result, _currentDatapoint);
+  _currentDatapoint = Datapoint(nullptr, 0, 0, noconv);
+}
+
+// errors that don't end the current request, like SUPERSEDED, come here directly
+void GWG::_tryOnError(OptolinkResult result, const Datapoint& datapoint) {
+  ++_metrics.results[static_cast<std::size_t>(result)];
   if (_onErrorCallback) {
-    _onErrorCallback(result, _currentDatapoint);
+    _onErrorCallback(result, datapoint);
   }
-  _currentDatapoint = Datapoint(nullptr, 0, 0, noconv);
+}
+
+void GWG::_createResponseBuffer() {
+  #if defined(VW_STATIC_PAYLOAD_LENGTH)
+  _responseBuffer = _responseStorage;
+  _allocatedLength = STATIC_PAYLOAD_LENGTH;
+  #else
+  _responseBuffer = reinterpret_cast<uint8_t*>(malloc(START_PAYLOAD_LENGTH));
+  if (!_responseBuffer) {
+    vw_log_e("Could not create response buffer");
+    vw_abort();
+  }
+  _allocatedLength = START_PAYLOAD_LENGTH;
+  #endif
 }
 
 bool GWG::_expandResponseBuffer(uint8_t newSize) {
   if (newSize > _allocatedLength) {
+    #if defined(VW_STATIC_PAYLOAD_LENGTH)
+    vw_log_w("Response too large: %u bytes", newSize);
+    return false;
+    #else
     uint8_t* newBuffer = reinterpret_cast<uint8_t*>(realloc(_responseBuffer, newSize));
     if (!newBuffer) {
       return false;
     }
     _responseBuffer = newBuffer;
     _allocatedLength = newSize;
+    #endif
   }
   return true;
 }
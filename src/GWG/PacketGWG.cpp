@@ -12,7 +12,8 @@ namespace VitoWiFi {
 
 PacketGWG::PacketGWG()
 : _allocatedLength(START_PAYLOAD_LENGTH + 5)
-, _buffer(nullptr) {
+, _buffer(nullptr)
+, _ownsBuffer(true) {
   _buffer = reinterpret_cast<uint8_t*>(malloc(_allocatedLength));
   if (!_buffer) {
     _allocatedLength = 0;
@@ -21,8 +22,15 @@ PacketGWG::PacketGWG()
   reset();
 }
 
+PacketGWG::PacketGWG(uint8_t* buffer, std::size_t size)
+: _allocatedLength(size)
+, _buffer(buffer)
+, _ownsBuffer(false) {
+  reset();
+}
+
 PacketGWG::~PacketGWG() {
-  free(_buffer);
+  if (_ownsBuffer) free(_buffer);
 }
 
 PacketGWG::operator bool() const {
@@ -64,6 +72,10 @@ bool PacketGWG::createPacket(uint8_t packetType, uint16_t addr, uint8_t len, con
   // reserve memory
   std::size_t toAllocate = (packetType == PacketGWGType.WRITE) ? len + 5 : 5;
   if (toAllocate > _allocatedLength) {
+    if (!_ownsBuffer) {
+      vw_log_w("Packet too large: %u bytes", static_cast<unsigned int>(toAllocate));
+      return false;
+    }
     uint8_t* newBuffer = reinterpret_cast<uint8_t*>(realloc(_buffer, toAllocate));
     if (!newBuffer) {
       return false;
@@ -40,8 +40,35 @@ class PacketGWG {
   void reset();
 
  protected:
+  PacketGWG(uint8_t* buffer, std::size_t size);
   std::size_t _allocatedLength;
   uint8_t* _buffer;
+  bool _ownsBuffer;
+};
+
+/*
+PacketGWG with inline storage for payloads up to PAYLOAD_CAPACITY bytes.
+Never allocates: packets that don't fit are refused.
+*/
+template <std::size_t PAYLOAD_CAPACITY>
+class StaticPacketGWG : private VitoWiFiInternals::PacketStorage<PAYLOAD_CAPACITY + 5>, public PacketGWG {
+ public:
+  StaticPacketGWG()
+  : VitoWiFiInternals::PacketStorage<PAYLOAD_CAPACITY + 5>()
+  , PacketGWG(this->_storage, PAYLOAD_CAPACITY + 5) {
+    // empty
+  }
 };
 
 }  // end namespace VitoWiFi
+
+namespace VitoWiFiInternals {
+
+// packet type used by the protocol implementations, see VW_STATIC_PAYLOAD_LENGTH
+#if defined(VW_STATIC_PAYLOAD_LENGTH)
+typedef VitoWiFi::StaticPacketGWG<VitoWiFi::STATIC_PAYLOAD_LENGTH> EnginePacketGWG;
+#else
+typedef VitoWiFi::PacketGWG EnginePacketGWG;
+#endif
+
+}  // end namespace VitoWiFiInternals
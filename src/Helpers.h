@@ -20,3 +20,32 @@ the LICENSE file.
 #endif
 
 #define vw_abort() abort()
+
+namespace VitoWiFiInternals {
+
+// milliseconds until more than period has passed since start, 0 when it already has
+inline uint32_t timeLeft(uint32_t now, uint32_t start, uint32_t period) {
+  uint32_t elapsed = now - start;
+  return (elapsed > period) ? 0 : period - elapsed + 1;
+}
+
+// index of the entry with the address and length of datapoint, size when there is none
+template <class ENTRY, class DATAPOINT>
+std::size_t indexOf(const ENTRY* entries, std::size_t size, const DATAPOINT& datapoint) {
+  std::size_t i = 0;
+  for (; i < size; ++i) {
+    if (entries[i].address == datapoint.address() && entries[i].length == datapoint.length()) {
+      break;
+    }
+  }
+  return i;
+}
+
+// Inline buffer, used as first base class so it is constructed before the packet using it
+template <std::size_t SIZE>
+struct PacketStorage {
+  PacketStorage() : _storage() {}
+  uint8_t _storage[SIZE];
+};
+
+}  // end namespace VitoWiFiInternals
@@ -17,6 +17,7 @@ namespace VitoWiFiInternals {
 template <class C>
 class GenericInterface : public SerialInterface {
  public:
+  using SerialInterface::read;
   explicit GenericInterface(C* interface)
   : _interface(interface) {
     if (!interface) {
@@ -19,6 +19,7 @@ namespace VitoWiFiInternals {
 
 class HardwareSerialInterface : public SerialInterface {
  public:
+  using SerialInterface::read;
   explicit HardwareSerialInterface(HardwareSerial* interface);
   bool begin();
   void end();
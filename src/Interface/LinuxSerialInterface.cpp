@@ -14,19 +14,23 @@ namespace VitoWiFiInternals {
 
 LinuxSerialInterface::LinuxSerialInterface(const char* interface)
 : _interfaceName(interface)
-, _fd(0)
-, _tty() {
+, _fd(-1)
+, _tty()
+, _rxBuffer()
+, _rxHead(0)
+, _rxTail(0) {
   assert(interface);
 }
 
 bool LinuxSerialInterface::begin() {
-  _fd = open(_interfaceName, O_RDWR);
+  // non blocking: reads return what has been received instead of waiting
+  _fd = open(_interfaceName, O_RDWR | O_NOCTTY | O_NONBLOCK);
   if (_fd < 0) {
-    vw_log_e("Error %i from open: %s\n", errno, strerror(errno));
+    vw_log_e("Error %i from open: %s", errno, strerror(errno));
     return false;
   }
   if (tcgetattr(_fd, &_tty) != 0) {
-    vw_log_e("Error %i from tcgetattr: %s\n", errno, strerror(errno));
+    vw_log_e("Error %i from tcgetattr: %s", errno, strerror(errno));
     return false;
   }
 
@@ -49,7 +53,7 @@ bool LinuxSerialInterface::begin() {
   // _tty.c_oflag &= ~OXTABS;  // Prevent conversion of tabs to spaces (NOT PRESENT ON LINUX)
   // _tty.c_oflag &= ~ONOEOT;  // Prevent removal of C-d chars (0x004) in output (NOT PRESENT ON LINUX)
 
-  _tty.c_cc[VTIME] = 10;  // Wait for up to 1s (10 deciseconds), returning as soon as any data is received.
+  _tty.c_cc[VTIME] = 0;  // Don't wait, the port is non blocking
   _tty.c_cc[VMIN] = 0;
 
   // Set in/out baud rate to be 9600
@@ -58,48 +62,75 @@ bool LinuxSerialInterface::begin() {
 
   // Save tty settings, also checking for error
   if (tcsetattr(_fd, TCSANOW, &_tty) != 0) {
-    vw_log_e("Error %i from tcsetattr: %s\n", errno, strerror(errno));
+    vw_log_e("Error %i from tcsetattr: %s", errno, strerror(errno));
     return false;
   }
 
+  _rxHead = 0;
+  _rxTail = 0;
   return true;
 }
 
 void LinuxSerialInterface::end() {
   ::close(_fd);
+  _fd = -1;
 }
 
 std::size_t LinuxSerialInterface::write(const uint8_t* data, uint8_t length) {
   ssize_t retVal = ::write(_fd, data, length);
   if (retVal < 0) {
-    vw_log_w("Error writing serial port");
+    if (errno != EAGAIN) {
+      vw_log_w("Error writing serial port");
+    }
     return 0;
   }
-  std::cout << "tx (" << unsigned(length) << "): 0x";
-  for (uint8_t i = 0; i < retVal; ++i) {
-    std::cout << std::setfill('0') << std::setw(2) << std::hex << unsigned(data[i]);
-  }
-  std::cout << std::endl;
+  vw_trace("tx", data, retVal);
   return retVal;
 }
 
 uint8_t LinuxSerialInterface::read() {
-  uint8_t buf;
-  ssize_t retVal = ::read(_fd, &buf, 1);
-  if (retVal < 0) {
-    vw_log_e("Error reading serial port");
-    return 0;
-  }
-  return buf;
+  if (_fill() == 0) return 0;
+  return _rxBuffer[_rxHead++];
 }
 
+// reads from the port when the buffer is empty, use pending() to only look at the buffer
 size_t LinuxSerialInterface::available() {
-  int bytesAvailable;
-  if (ioctl(_fd, FIONREAD, &bytesAvailable) < 0) {
-    vw_log_e("Error reading serial port");
-    return 0;
+  return _fill();
+}
+
+std::size_t LinuxSerialInterface::read(uint8_t* buffer, std::size_t length) {
+  std::size_t count = _fill();
+  if (count > length) count = length;
+  memcpy(buffer, &_rxBuffer[_rxHead], count);
+  _rxHead += count;
+  return count;
+}
+
+int LinuxSerialInterface::fd() const {
+  return _fd;
+}
+
+// bytes already taken from the port: poll() on fd() doesn't see them anymore
+std::size_t LinuxSerialInterface::pending() {
+  return _rxTail - _rxHead;
+}
+
+// returns the number of buffered bytes, reading from the port only when the buffer is empty
+std::size_t LinuxSerialInterface::_fill() {
+  if (_rxHead == _rxTail) {
+    _rxHead = 0;
+    _rxTail = 0;
+    ssize_t retVal = ::read(_fd, _rxBuffer, sizeof(_rxBuffer));
+    if (retVal < 0) {
+      if (errno != EAGAIN) {
+        vw_log_e("Error reading serial port");
+      }
+      return 0;
+    }
+    _rxTail = retVal;
+    vw_trace("rx", _rxBuffer, _rxTail);
   }
-  return bytesAvailable;
+  return _rxTail - _rxHead;
 }
 
 }  // end namespace VitoWiFiInternals
@@ -28,7 +28,6 @@ https://github.com/gbmhunter/CppLinuxSerial
 #include <errno.h>  // Error integer and strerror() function
 #include <termios.h>  // Contains POSIX terminal control definitions
 #include <unistd.h>  // write(), read(), close()
-#include <sys/ioctl.h>
 
 #include "SerialInterface.h"
 #include "../Logging.h"
@@ -43,11 +42,21 @@ class LinuxSerialInterface : public SerialInterface {
   std::size_t write(const uint8_t* data, uint8_t length) override;
   uint8_t read() override;
   size_t available() override;
+  std::size_t read(uint8_t* buffer, std::size_t length) override;
+  int fd() const override;
+  std::size_t pending() override;
 
  private:
   const char* _interfaceName;
   int _fd;
   struct termios _tty;
+  // received bytes, refilled with one read() when empty
+  // the engines empty it before they read again so a ring buffer wouldn't wrap
+  uint8_t _rxBuffer[64];
+  std::size_t _rxHead;
+  std::size_t _rxTail;
+
+  std::size_t _fill();
 };
 
 }  // end namespace VitoWiFiInternals
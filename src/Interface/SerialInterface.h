@@ -21,6 +21,27 @@ class SerialInterface {
   virtual std::size_t write(const uint8_t* data, uint8_t length) = 0;
   virtual uint8_t read() = 0;
   virtual size_t available() = 0;
+
+  // Reads up to length bytes without waiting. Returns the number of bytes read.
+  // Override when the interface can do better than reading byte by byte.
+  virtual std::size_t read(uint8_t* buffer, std::size_t length) {
+    std::size_t count = 0;
+    while (count < length && available() > 0) {
+      buffer[count++] = read();
+    }
+    return count;
+  }
+
+  // File descriptor to wait on for incoming data, -1 when there is none.
+  virtual int fd() const {
+    return -1;
+  }
+
+  // Received bytes a wait on fd() won't report, without reading from the port.
+  // Interfaces without fd() can't be waited on so all available bytes count.
+  virtual std::size_t pending() {
+    return available();
+  }
 };
 
 }  // end namespace VitoWiFiInternals
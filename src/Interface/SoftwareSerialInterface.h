@@ -19,6 +19,7 @@ namespace VitoWiFiInternals {
 
 class SoftwareSerialInterface : public SerialInterface {
  public:
+  using SerialInterface::read;
   explicit SoftwareSerialInterface(SoftwareSerial* interface);
   bool begin();
   void end();
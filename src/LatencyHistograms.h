@@ -0,0 +1,250 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "Constants.h"
+
+namespace VitoWiFi {
+
+// TOTAL runs from read() or write() until onResponse or onError
+enum class LatencyPhase : uint8_t {
+  QUEUE,  // waiting in the queue
+  SEND,  // from leaving the queue until the last byte of the request is sent
+  RESPONSE,  // until the first byte of the response arrives
+  RECEIVE,  // until the response is complete
+  TOTAL
+};
+constexpr size_t NUMBER_OF_LATENCY_PHASES = 5;
+constexpr size_t LATENCY_BUCKETS = 16;
+constexpr uint32_t LATENCY_NOT_REACHED = UINT32_MAX;
+
+/*
+Latency histogram with log-scaled buckets in milliseconds: bucket 0 holds
+0 ms, bucket i holds [2^(i-1), 2^i) ms and the last bucket holds everything
+from 2^14 ms.
+*/
+struct LatencyHistogram {
+  LatencyHistogram()
+  : buckets()
+  , count(0)
+  , max(0) {
+    // empty
+  }
+
+  void add(uint32_t ms) {
+    std::size_t bucket = 0;
+    for (uint32_t value = ms; value > 0 && bucket < LATENCY_BUCKETS - 1; value >>= 1) {
+      ++bucket;
+    }
+    ++buckets[bucket];
+    ++count;
+    if (ms > max) max = ms;
+  }
+
+  // exclusive upper limit of bucket
+  static uint32_t bucketLimit(std::size_t bucket) {
+    return (bucket < LATENCY_BUCKETS - 1) ? (1UL << bucket) : UINT32_MAX;
+  }
+
+  // upper limit of the bucket that completes fraction (0..1) of the samples, 0 without samples
+  uint32_t percentile(float fraction) const {
+    if (count == 0) return 0;
+    uint32_t target = static_cast<uint32_t>(fraction * count + 0.5f);
+    if (target == 0) target = 1;
+    uint32_t seen = 0;
+    for (std::size_t i = 0; i < LATENCY_BUCKETS; ++i) {
+      seen += buckets[i];
+      if (seen >= target) return (i < LATENCY_BUCKETS - 1) ? bucketLimit(i) : max;
+    }
+    return max;
+  }
+
+  uint32_t buckets[LATENCY_BUCKETS];
+  uint32_t count;
+  uint32_t max;
+};
+
+// Durations of one request. Phases the request didn't complete are LATENCY_NOT_REACHED.
+struct LatencySample {
+  uint16_t address;
+  OptolinkResult result;  // PACKET when a response was received
+  uint32_t phases[NUMBER_OF_LATENCY_PHASES];  // ms, indexed by LatencyPhase
+};
+
+// Receives a sample of every finished request. Called from loop() before onResponse or onError.
+class LatencyRecorder {
+ public:
+  virtual ~LatencyRecorder() {}
+  virtual void record(const LatencySample& sample) = 0;
+};
+
+/*
+Latency histograms per datapoint address and per phase for up to SIZE
+addresses. Addresses get a slot on their first sample, or up front with
+add(). Samples of addresses that don't fit anymore are only counted in
+dropped(). All storage is part of the object: nothing is allocated.
+*/
+template <std::size_t SIZE>
+class LatencyHistograms : public LatencyRecorder {
+  static_assert(SIZE > 0, "LatencyHistograms size has to be at least 1");
+
+ public:
+  LatencyHistograms()
+  : _addresses()
+  , _errors()
+  , _histograms()
+  , _size(0)
+  , _dropped(0) {
+    // empty
+  }
+  LatencyHistograms(const LatencyHistograms&) = delete;
+  LatencyHistograms & operator=(const LatencyHistograms&) = delete;
+
+  // Reserves a slot for address. Returns false when all slots are taken.
+  bool add(uint16_t address) {
+    return _slot(address) < SIZE;
+  }
+
+  void record(const LatencySample& sample) override {
+    std::size_t slot = _slot(sample.address);
+    if (slot == SIZE) {
+      ++_dropped;
+      return;
+    }
+    if (sample.result != OptolinkResult::PACKET) ++_errors[slot];
+    for (std::size_t i = 0; i < NUMBER_OF_LATENCY_PHASES; ++i) {
+      if (sample.phases[i] != LATENCY_NOT_REACHED) _histograms[slot][i].add(sample.phases[i]);
+    }
+  }
+
+  // nullptr when address has no slot
+  const LatencyHistogram* histogram(uint16_t address, LatencyPhase phase) const {
+    std::size_t slot = _find(address);
+    if (slot == SIZE) return nullptr;
+    return &_histograms[slot][static_cast<std::size_t>(phase)];
+  }
+
+  // requests to address that ended in onError
+  uint32_t errors(uint16_t address) const {
+    std::size_t slot = _find(address);
+    return (slot < SIZE) ? _errors[slot] : 0;
+  }
+
+  // number of addresses with a slot, use address(index) to iterate
+  std::size_t size() const {
+    return _size;
+  }
+
+  uint16_t address(std::size_t index) const {
+    return _addresses[index];
+  }
+
+  uint32_t dropped() const {
+    return _dropped;
+  }
+
+  // clears the samples, the slots are kept
+  void reset() {
+    for (std::size_t i = 0; i < SIZE; ++i) {
+      _errors[i] = 0;
+      for (std::size_t j = 0; j < NUMBER_OF_LATENCY_PHASES; ++j) {
+        _histograms[i][j] = LatencyHistogram();
+      }
+    }
+    _dropped = 0;
+  }
+
+ private:
+  uint16_t _addresses[SIZE];
+  uint32_t _errors[SIZE];
+  LatencyHistogram _histograms[SIZE][NUMBER_OF_LATENCY_PHASES];
+  std::size_t _size;
+  uint32_t _dropped;
+
+  // SIZE when address has no slot
+  std::size_t _find(uint16_t address) const {
+    for (std::size_t i = 0; i < _size; ++i) {
+      if (_addresses[i] == address) return i;
+    }
+    return SIZE;
+  }
+
+  // adds a slot when there is none yet, SIZE when full
+  std::size_t _slot(uint16_t address) {
+    std::size_t slot = _find(address);
+    if (slot < SIZE || _size == SIZE) return slot;
+    _addresses[_size] = address;
+    return _size++;
+  }
+};
+
+}  // end namespace VitoWiFi
+
+namespace VitoWiFiInternals {
+
+/*
+Timestamps of a request in the engines. reached is the number of steps
+taken: setting a step invalidates the steps after it, eg. when a request
+is sent again.
+*/
+struct RequestTimes {
+  enum Step : uint8_t {
+    ENQUEUED,
+    DISPATCHED,
+    SENT,
+    RESPONDED
+  };
+
+  RequestTimes()
+  : time()
+  , reached(0) {
+    // empty
+  }
+
+  void set(Step step, uint32_t now) {
+    time[step] = now;
+    reached = step + 1;
+  }
+
+  // timestamps come from separate clock reads and can be slightly out of order
+  static uint32_t elapsed(uint32_t from, uint32_t to) {
+    return (static_cast<int32_t>(to - from) < 0) ? 0 : to - from;
+  }
+
+  uint32_t time[4];
+  uint8_t reached;
+};
+
+inline void recordLatency(VitoWiFi::LatencyRecorder* recorder,
+                          uint16_t address,
+                          const RequestTimes& times,
+                          uint32_t now,
+                          VitoWiFi::OptolinkResult result) {
+  if (!recorder || times.reached == 0) return;
+  VitoWiFi::LatencySample sample;
+  sample.address = address;
+  sample.result = result;
+  // phase i runs from step i to step i + 1, the last one ends with the response
+  for (std::size_t i = 0; i < 4; ++i) {
+    if (i + 1U < times.reached) {
+      sample.phases[i] = RequestTimes::elapsed(times.time[i], times.time[i + 1]);
+    } else if (i + 1U == times.reached && i == 3 && result == VitoWiFi::OptolinkResult::PACKET) {
+      sample.phases[i] = RequestTimes::elapsed(times.time[i], now);
+    } else {
+      sample.phases[i] = VitoWiFi::LATENCY_NOT_REACHED;
+    }
+  }
+  sample.phases[static_cast<std::size_t>(VitoWiFi::LatencyPhase::TOTAL)] = RequestTimes::elapsed(times.time[RequestTimes::ENQUEUED], now);
+  recorder->record(sample);
+}
+
+}  // end namespace VitoWiFiInternals
@@ -0,0 +1,207 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#pragma once
+
+#if defined(__linux__)
+
+#include <cstdint>
+#include <cstddef>
+
+#include <poll.h>
+
+#include "Constants.h"
+#include "RequestQueue.h"
+#include "LinkMetrics.h"
+
+namespace VitoWiFi {
+
+template <class PROTOCOLVERSION>
+class VitoWiFi;
+
+/*
+Drives several VitoWiFi objects, each with its own serial adapter and of
+any protocol, from one thread. loop() waits in poll() on all serial ports
+until one of them has data or a protocol timeout is due and then only
+runs the links that need it.
+The VitoWiFi objects are stored by reference and have to remain valid.
+*/
+template <std::size_t SIZE>
+class LinkManager {
+  static_assert(SIZE > 0 && SIZE < 256, "LinkManager size has to be between 1 and 255");
+
+ public:
+  LinkManager()
+  : _links()
+  , _numLinks(0)
+  , _wakeups(0)
+  , _serviced(0) {
+    // empty
+  }
+  LinkManager(const LinkManager&) = delete;
+  LinkManager & operator=(const LinkManager&) = delete;
+
+  // Returns false when the manager is full.
+  template <class PROTOCOLVERSION>
+  bool add(VitoWiFi<PROTOCOLVERSION>* vitoWiFi) {
+    if (_numLinks == SIZE || !vitoWiFi) return false;
+    Link& link = _links[_numLinks++];
+    link.vitoWiFi = vitoWiFi;
+    link.loop = &_loop<PROTOCOLVERSION>;
+    link.fd = &_fd<PROTOCOLVERSION>;
+    link.nextTimeout = &_nextTimeout<PROTOCOLVERSION>;
+    link.isBusy = &_isBusy<PROTOCOLVERSION>;
+    link.queueStats = &_queueStats<PROTOCOLVERSION>;
+    link.metrics = &_metrics<PROTOCOLVERSION>;
+    return true;
+  }
+
+  // Waits at most maxWait milliseconds for a link to need service, then runs those links.
+  // Returns the number of links that were run.
+  std::size_t loop(uint32_t maxWait = UINT32_MAX) {
+    struct pollfd fds[SIZE];
+    uint32_t timeout = maxWait;
+    for (std::size_t i = 0; i < _numLinks; ++i) {
+      uint32_t linkTimeout = _links[i].nextTimeout(_links[i].vitoWiFi);
+      if (linkTimeout < timeout) timeout = linkTimeout;
+      fds[i].fd = _links[i].fd(_links[i].vitoWiFi);  // negative descriptors are ignored by poll()
+      fds[i].events = POLLIN;
+      fds[i].revents = 0;
+    }
+    int waitTime = (timeout > INT32_MAX) ? -1 : static_cast<int>(timeout);
+    if (poll(fds, _numLinks, waitTime) < 0) {
+      return 0;  // interrupted
+    }
+    ++_wakeups;
+    std::size_t serviced = 0;
+    for (std::size_t i = 0; i < _numLinks; ++i) {
+      Link& link = _links[i];
+      if (fds[i].revents != 0 || fds[i].fd < 0 || link.nextTimeout(link.vitoWiFi) == 0) {
+        link.loop(link.vitoWiFi);
+        ++serviced;
+      }
+    }
+    _serviced += serviced;
+    return serviced;
+  }
+
+  std::size_t size() const {
+    return _numLinks;
+  }
+
+  // Number of links with requests queued or in progress.
+  std::size_t busyLinks() const {
+    std::size_t busy = 0;
+    for (std::size_t i = 0; i < _numLinks; ++i) {
+      if (_links[i].isBusy(_links[i].vitoWiFi)) ++busy;
+    }
+    return busy;
+  }
+
+  // Queue statistics of priority summed over all links, maxima are the maximum of all links.
+  QueueStats queueStats(Priority priority) const {
+    QueueStats total;
+    for (std::size_t i = 0; i < _numLinks; ++i) {
+      const QueueStats& stats = _links[i].queueStats(_links[i].vitoWiFi, priority);
+      total.enqueued += stats.enqueued;
+      total.dispatched += stats.dispatched;
+      total.rejected += stats.rejected;
+      total.coalesced += stats.coalesced;
+      total.depth += stats.depth;
+      if (stats.maxDepth > total.maxDepth) total.maxDepth = stats.maxDepth;
+      total.totalWait += stats.totalWait;
+      if (stats.maxWait > total.maxWait) total.maxWait = stats.maxWait;
+    }
+    return total;
+  }
+
+  // Link metrics summed over all links. stateTime stays 0: state numbers differ per protocol.
+  LinkMetrics metrics() const {
+    LinkMetrics total;
+    for (std::size_t i = 0; i < _numLinks; ++i) {
+      LinkMetrics metrics = _links[i].metrics(_links[i].vitoWiFi);
+      for (std::size_t j = 0; j < NUMBER_OF_RESULTS; ++j) {
+        total.results[j] += metrics.results[j];
+      }
+      total.resets += metrics.resets;
+      total.inits += metrics.inits;
+      total.keepAlives += metrics.keepAlives;
+      total.checksumErrors += metrics.checksumErrors;
+      total.resyncs += metrics.resyncs;
+      total.bytesSent += metrics.bytesSent;
+      total.bytesReceived += metrics.bytesReceived;
+    }
+    return total;
+  }
+
+  // Link metrics of the index-th link added, including stateTime.
+  LinkMetrics metrics(std::size_t index) const {
+    return _links[index].metrics(_links[index].vitoWiFi);
+  }
+
+  // Number of times loop() returned from waiting.
+  uint32_t wakeups() const {
+    return _wakeups;
+  }
+
+  // Number of times a link was run.
+  uint32_t serviced() const {
+    return _serviced;
+  }
+
+ private:
+  // type erased VitoWiFi object
+  struct Link {
+    void* vitoWiFi;
+    void (*loop)(void*);
+    int (*fd)(const void*);
+    uint32_t (*nextTimeout)(const void*);
+    bool (*isBusy)(void*);
+    const QueueStats& (*queueStats)(const void*, Priority);
+    LinkMetrics (*metrics)(const void*);
+  };
+
+  Link _links[SIZE];
+  std::size_t _numLinks;
+  uint32_t _wakeups;
+  uint32_t _serviced;
+
+  template <class PROTOCOLVERSION>
+  static void _loop(void* vitoWiFi) {
+    static_cast<VitoWiFi<PROTOCOLVERSION>*>(vitoWiFi)->loop();
+  }
+
+  template <class PROTOCOLVERSION>
+  static int _fd(const void* vitoWiFi) {
+    return static_cast<const VitoWiFi<PROTOCOLVERSION>*>(vitoWiFi)->fd();
+  }
+
+  template <class PROTOCOLVERSION>
+  static uint32_t _nextTimeout(const void* vitoWiFi) {
+    return static_cast<const VitoWiFi<PROTOCOLVERSION>*>(vitoWiFi)->nextTimeout();
+  }
+
+  template <class PROTOCOLVERSION>
+  static bool _isBusy(void* vitoWiFi) {
+    return static_cast<VitoWiFi<PROTOCOLVERSION>*>(vitoWiFi)->isBusy();
+  }
+
+  template <class PROTOCOLVERSION>
+  static const QueueStats& _queueStats(const void* vitoWiFi, Priority priority) {
+    return static_cast<const VitoWiFi<PROTOCOLVERSION>*>(vitoWiFi)->queueStats(priority);
+  }
+
+  template <class PROTOCOLVERSION>
+  static LinkMetrics _metrics(const void* vitoWiFi) {
+    return static_cast<const VitoWiFi<PROTOCOLVERSION>*>(vitoWiFi)->metrics();
+  }
+};
+
+}  // end namespace VitoWiFi
+
+#endif
@@ -0,0 +1,51 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "Constants.h"
+
+namespace VitoWiFi {
+
+// upper bound of the state numbers returned by getState()
+constexpr size_t MAX_LINK_STATES = 16;
+
+/*
+Health counters of an Optolink connection. Counters only go up: take the
+difference of two snapshots for rates. Counters that don't apply to a
+protocol stay 0.
+*/
+struct LinkMetrics {
+  LinkMetrics()
+  : results()
+  , resets(0)
+  , inits(0)
+  , keepAlives(0)
+  , checksumErrors(0)
+  , resyncs(0)
+  , bytesSent(0)
+  , bytesReceived(0)
+  , stateTime() {
+    // empty
+  }
+
+  uint32_t results[NUMBER_OF_RESULTS];  // finished requests per OptolinkResult, PACKET counts the responses
+  uint32_t resets;  // EOTs sent to reset the connection
+  uint32_t inits;  // connection set-ups after begin(), a reset or a timeout
+  uint32_t keepAlives;  // VS2 SYNCs sent while idle
+  uint32_t checksumErrors;  // VS2 responses with a wrong checksum, also when retransmitted
+  uint32_t resyncs;  // VS2 parser dropped bytes to find the next packet start
+  uint32_t bytesSent;
+  uint32_t bytesReceived;
+  uint32_t stateTime[MAX_LINK_STATES];  // ms spent per state, indexed by getState()
+};
+
+}  // end namespace VitoWiFi
@@ -0,0 +1,165 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+#include "Constants.h"
+#include "Datapoint/Datapoint.h"
+#include "VS2/PacketVS2.h"
+
+namespace VitoWiFi {
+
+template <class PROTOCOLVERSION>
+class Source;
+
+/*
+Receives all responses and errors of a Source, next to the callbacks
+attached to the source itself. Override the handleResponse of your
+protocol: VS2 passes the packet, VS1 and GWG the data.
+Listeners are linked into the source, nothing is allocated.
+*/
+class Listener {
+ public:
+  Listener()
+  : _next(nullptr) {}
+  virtual ~Listener() {}
+
+  virtual void handleResponse(const PacketVS2& response, const Datapoint& request) {
+    (void) response;
+    (void) request;
+  }
+
+  virtual void handleResponse(const uint8_t* data, uint8_t length, const Datapoint& request) {
+    (void) data;
+    (void) length;
+    (void) request;
+  }
+
+  virtual void handleError(OptolinkResult error, const Datapoint& request) {
+    (void) error;
+    (void) request;
+  }
+
+ private:
+  template <class PROTOCOLVERSION>
+  friend class Source;
+  Listener* _next;
+};
+
+}  // end namespace VitoWiFi
+
+namespace VitoWiFiInternals {
+
+typedef std::function<void(const VitoWiFi::PacketVS2&, const VitoWiFi::Datapoint&)> PacketCallback;
+typedef std::function<void(const uint8_t*, uint8_t, const VitoWiFi::Datapoint&)> DataCallback;
+
+// Calls a response callback. Only the overloads matching the callback
+// signature do something: a protocol never produces the other form.
+inline void notify(const PacketCallback& callback, const VitoWiFi::PacketVS2& response, const VitoWiFi::Datapoint& request) {
+  if (callback) callback(response, request);
+}
+
+inline void notify(const DataCallback& callback, const uint8_t* data, uint8_t length, const VitoWiFi::Datapoint& request) {
+  if (callback) callback(data, length, request);
+}
+
+inline void notify(const PacketCallback& callback, const uint8_t* data, uint8_t length, const VitoWiFi::Datapoint& request) {
+  (void) callback;
+  (void) data;
+  (void) length;
+  (void) request;
+}
+
+inline void notify(const DataCallback& callback, const VitoWiFi::PacketVS2& response, const VitoWiFi::Datapoint& request) {
+  (void) callback;
+  (void) response;
+  (void) request;
+}
+
+}  // end namespace VitoWiFiInternals
+
+namespace VitoWiFi {
+
+/*
+Passes responses and errors on to its callbacks and listeners. VitoWiFi
+passes on what comes from the Optolink, the components what they made of
+it, so components can be stacked: a ChangeFilter on a ReadPlanner filters
+the split responses.
+*/
+template <class PROTOCOLVERSION>
+class Source {
+ public:
+  Source()
+  : _first(nullptr)
+  , _onResponseCallback(nullptr)
+  , _onErrorCallback(nullptr) {}
+  Source(const Source&) = delete;
+  Source & operator=(const Source&) = delete;
+
+  void onResponse(typename PROTOCOLVERSION::OnResponseCallback callback) {
+    _onResponseCallback = callback;
+  }
+
+  void onError(typename PROTOCOLVERSION::OnErrorCallback callback) {
+    _onErrorCallback = callback;
+  }
+
+  // Listeners are called before the callbacks, in the order they were added.
+  void addListener(Listener* listener) {
+    Listener** last = &_first;
+    while (*last) {
+      if (*last == listener) return;
+      last = &(*last)->_next;
+    }
+    listener->_next = nullptr;
+    *last = listener;
+  }
+
+  void removeListener(Listener* listener) {
+    for (Listener** it = &_first; *it; it = &(*it)->_next) {
+      if (*it == listener) {
+        *it = listener->_next;
+        listener->_next = nullptr;
+        return;
+      }
+    }
+  }
+
+ protected:
+  void _emitResponse(const PacketVS2& response, const Datapoint& request) const {
+    for (Listener* listener = _first; listener; listener = listener->_next) {
+      listener->handleResponse(response, request);
+    }
+    VitoWiFiInternals::notify(_onResponseCallback, response, request);
+  }
+
+  void _emitResponse(const uint8_t* data, uint8_t length, const Datapoint& request) const {
+    for (Listener* listener = _first; listener; listener = listener->_next) {
+      listener->handleResponse(data, length, request);
+    }
+    VitoWiFiInternals::notify(_onResponseCallback, data, length, request);
+  }
+
+  void _emitError(OptolinkResult error, const Datapoint& request) const {
+    for (Listener* listener = _first; listener; listener = listener->_next) {
+      listener->handleError(error, request);
+    }
+    if (_onErrorCallback) _onErrorCallback(error, request);
+  }
+
+ private:
+  Listener* _first;
+  typename PROTOCOLVERSION::OnResponseCallback _onResponseCallback;
+  typename PROTOCOLVERSION::OnErrorCallback _onErrorCallback;
+};
+
+}  // end namespace VitoWiFi
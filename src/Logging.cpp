@@ -0,0 +1,55 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#include "Logging.h"
+
+#if !defined(ARDUINO_ARCH_ESP32) && !defined(ARDUINO_ARCH_ESP8266)
+
+#include <cstdio>
+#include <cstdarg>
+
+namespace VitoWiFiInternals {
+
+static void defaultSink(VitoWiFi::LogLevel level, const char* file, int line, const char* message) {
+  static const char levels[] = {'?', 'E', 'W', 'I', 'T'};
+  printf("[%c] %s:%i: %s\n", levels[static_cast<uint8_t>(level)], file, line, message);
+}
+
+static VitoWiFi::LogSink logSink = defaultSink;
+
+void log(VitoWiFi::LogLevel level, const char* file, int line, const char* format, ...) {
+  if (!logSink) return;
+  char message[128];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+  logSink(level, file, line, message);
+}
+
+void logData(const char* file, int line, const char* label, const uint8_t* data, std::size_t length) {
+  if (!logSink) return;
+  char message[128];
+  int pos = snprintf(message, sizeof(message), "%s (%u): 0x", label, static_cast<unsigned int>(length));
+  for (std::size_t i = 0; i < length && pos + 3 < static_cast<int>(sizeof(message)); ++i) {
+    pos += snprintf(&message[pos], sizeof(message) - pos, "%02x", data[i]);
+  }
+  logSink(VitoWiFi::LogLevel::TRACE, file, line, message);
+}
+
+}  // end namespace VitoWiFiInternals
+
+namespace VitoWiFi {
+
+void setLogSink(LogSink sink) {
+  VitoWiFiInternals::logSink = sink;
+}
+
+}  // end namespace VitoWiFi
+
+#endif
@@ -35,10 +35,64 @@ the LICENSE file.
     #define vw_log_w(...)
   #endif
 #else
-  // when building for PC, always show debug statements as part of testing suite
-  #include <iostream>
-  #include <iomanip>
-  #define vw_log_i(...) std::cout << "[I] " << __FILE__ ":" << __LINE__ << ": "; printf(__VA_ARGS__); std::cout << std::endl
-  #define vw_log_e(...) std::cout << "[E] " << __FILE__ ":" << __LINE__ << ": "; printf(__VA_ARGS__); std::cout << std::endl
-  #define vw_log_w(...) std::cout << "[W] " << __FILE__ ":" << __LINE__ << ": "; printf(__VA_ARGS__); std::cout << std::endl
+  // when building for PC, messages go to a replaceable sink
+  // levels above VW_LOG_LEVEL are removed at compile time: 0 = off, 1 = errors, 2 = warnings, 3 = info, 4 = wire trace
+  #include <cstdint>
+  #include <cstddef>
+  #if !defined(VW_LOG_LEVEL)
+    #if defined(DEBUG_VITOWIFI)
+      #define VW_LOG_LEVEL 4
+    #else
+      #define VW_LOG_LEVEL 1
+    #endif
+  #endif
+
+namespace VitoWiFi {
+
+enum class LogLevel : uint8_t {
+  ERROR = 1,
+  WARNING,
+  INFO,
+  TRACE
+};
+
+// Receives every message that is compiled in. file and line point to the origin.
+typedef void (*LogSink)(LogLevel level, const char* file, int line, const char* message);
+
+// Replaces the default sink which prints to stdout. nullptr drops all messages.
+void setLogSink(LogSink sink);
+
+}  // end namespace VitoWiFi
+
+namespace VitoWiFiInternals {
+
+void log(VitoWiFi::LogLevel level, const char* file, int line, const char* format, ...)
+  __attribute__((format(printf, 4, 5)));
+void logData(const char* file, int line, const char* label, const uint8_t* data, std::size_t length);
+
+}  // end namespace VitoWiFiInternals
+
+  #if VW_LOG_LEVEL >= 1
+    #define vw_log_e(...) ::VitoWiFiInternals::log(::VitoWiFi::LogLevel::ERROR, __FILE__, __LINE__, __VA_ARGS__)
+  #else
+    #define vw_log_e(...)
+  #endif
+  #if VW_LOG_LEVEL >= 2
+    #define vw_log_w(...) ::VitoWiFiInternals::log(::VitoWiFi::LogLevel::WARNING, __FILE__, __LINE__, __VA_ARGS__)
+  #else
+    #define vw_log_w(...)
+  #endif
+  #if VW_LOG_LEVEL >= 3
+    #define vw_log_i(...) ::VitoWiFiInternals::log(::VitoWiFi::LogLevel::INFO, __FILE__, __LINE__, __VA_ARGS__)
+  #else
+    #define vw_log_i(...)
+  #endif
+  #if VW_LOG_LEVEL >= 4
+    #define vw_trace(label, data, length) ::VitoWiFiInternals::logData(__FILE__, __LINE__, label, data, length)
+  #endif
+#endif
+
+// bytes on the wire, only available on PC
+#if !defined(vw_trace)
+  #define vw_trace(label, data, length)
 #endif
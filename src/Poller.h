@@ -0,0 +1,115 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "Constants.h"
+#include "Helpers.h"
+#include "Logging.h"
+#include "Datapoint/Datapoint.h"
+
+namespace VitoWiFi {
+
+template <class PROTOCOLVERSION>
+class VitoWiFi;
+
+/*
+Reads datapoints periodically, each with its own interval in milliseconds.
+A read is only submitted when VitoWiFi is idle and as a background request,
+so polling never delays other requests. When several datapoints are due,
+the one that is the most overdue goes first so none of them starves.
+
+Responses arrive through the callbacks of the VitoWiFi object.
+Datapoints are stored by reference and have to remain valid.
+*/
+template <class PROTOCOLVERSION, std::size_t SIZE>
+class Poller {
+  static_assert(SIZE > 0, "Poller size has to be at least 1");
+
+ public:
+  explicit Poller(VitoWiFi<PROTOCOLVERSION>* vitoWiFi)
+  : _vitoWiFi(vitoWiFi)
+  , _entries()
+  , _numEntries(0) {
+    // empty
+  }
+  Poller(const Poller&) = delete;
+  Poller & operator=(const Poller&) = delete;
+
+  // The datapoint is read for the first time at the next loop().
+  // Returns false when the poller is full.
+  bool add(const Datapoint& datapoint, uint32_t interval) {
+    if (_numEntries == SIZE || !datapoint) return false;
+    Entry& entry = _entries[_numEntries++];
+    entry.datapoint = &datapoint;
+    entry.interval = interval;
+    entry.lastPoll = 0;
+    entry.polled = false;
+    return true;
+  }
+
+  void clear() {
+    _numEntries = 0;
+  }
+
+  // Submits the most overdue datapoint when VitoWiFi is idle.
+  void loop() {
+    if (_vitoWiFi->isBusy()) return;
+    uint32_t now = vw_millis();
+    Entry* next = nullptr;
+    uint32_t maxOverdue = 0;
+    for (std::size_t i = 0; i < _numEntries; ++i) {
+      Entry& entry = _entries[i];
+      if (entry.polled && now - entry.lastPoll < entry.interval) continue;
+      uint32_t overdue = entry.polled ? now - entry.lastPoll - entry.interval : UINT32_MAX;
+      if (!next || overdue > maxOverdue) {
+        next = &entry;
+        maxOverdue = overdue;
+      }
+    }
+    if (next && _vitoWiFi->read(*next->datapoint, Priority::BACKGROUND)) {
+      next->lastPoll = now;
+      next->polled = true;
+    }
+  }
+
+  // Milliseconds until the next datapoint is due, 0 when one is due already
+  // and UINT32_MAX when there are no datapoints.
+  uint32_t nextDue() const {
+    uint32_t now = vw_millis();
+    uint32_t retVal = UINT32_MAX;
+    for (std::size_t i = 0; i < _numEntries; ++i) {
+      const Entry& entry = _entries[i];
+      uint32_t elapsed = now - entry.lastPoll;
+      if (!entry.polled || elapsed >= entry.interval) return 0;
+      if (entry.interval - elapsed < retVal) retVal = entry.interval - elapsed;
+    }
+    return retVal;
+  }
+
+  std::size_t size() const {
+    return _numEntries;
+  }
+
+ private:
+  struct Entry {
+    const Datapoint* datapoint;
+    uint32_t interval;
+    uint32_t lastPoll;
+    bool polled;
+  };
+
+  VitoWiFi<PROTOCOLVERSION>* _vitoWiFi;
+  Entry _entries[SIZE];
+  std::size_t _numEntries;
+};
+
+}  // end namespace VitoWiFi
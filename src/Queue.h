@@ -0,0 +1,93 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace VitoWiFiInternals {
+
+/*
+Fixed-capacity FIFO ring buffer.
+Storage is inline so the queue never touches the heap.
+T has to be default constructible and copy assignable.
+*/
+template <typename T, std::size_t SIZE>
+class Queue {
+  static_assert(SIZE > 0, "Queue size has to be at least 1");
+
+ public:
+  Queue()
+  : _head(0)
+  , _size(0)
+  , _buffer() {
+    // empty
+  }
+
+  // Enqueues a copy of item. Returns false when the queue is full.
+  bool push(const T& item) {
+    T* slot = acquire();
+    if (!slot) return false;
+    *slot = item;
+    return true;
+  }
+
+  // Enqueues a slot and returns a pointer to it so it can be filled in place.
+  // Returns nullptr when the queue is full.
+  T* acquire() {
+    if (full()) return nullptr;
+    T* slot = &_buffer[(_head + _size) % SIZE];
+    ++_size;
+    return slot;
+  }
+
+  // Oldest element. Only valid when the queue is not empty.
+  T& front() {
+    return _buffer[_head];
+  }
+
+  void pop() {
+    if (_size == 0) return;
+    _head = (_head + 1) % SIZE;
+    --_size;
+  }
+
+  // Element at position index, counted from the front.
+  T& operator[](std::size_t index) {
+    return _buffer[(_head + index) % SIZE];
+  }
+
+  void clear() {
+    _head = 0;
+    _size = 0;
+  }
+
+  std::size_t size() const {
+    return _size;
+  }
+
+  bool empty() const {
+    return _size == 0;
+  }
+
+  bool full() const {
+    return _size == SIZE;
+  }
+
+  static constexpr std::size_t capacity() {
+    return SIZE;
+  }
+
+ private:
+  std::size_t _head;
+  std::size_t _size;
+  T _buffer[SIZE];
+};
+
+}  // end namespace VitoWiFiInternals
@@ -0,0 +1,246 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+
+#include "Constants.h"
+#include "Helpers.h"
+#include "Listener.h"
+#include "Logging.h"
+#include "Datapoint/Datapoint.h"
+#include "VS2/PacketVS2.h"
+
+namespace VitoWiFi {
+
+template <class PROTOCOLVERSION>
+class VitoWiFi;
+
+/*
+Reads a set of datapoints with as few Optolink transactions as possible.
+Datapoints with adjacent or nearly adjacent addresses are merged into one
+larger read. The response is split again and the callbacks are called per
+datapoint with the datapoint's own address, length and converter.
+Responses to other requests are passed through.
+Datapoints are stored by reference and have to remain valid.
+Mind that bytes in the gaps between datapoints are also read: only allow
+gaps when the addresses in between exist on your device.
+*/
+template <class PROTOCOLVERSION, std::size_t SIZE>
+class ReadPlanner : public Source<PROTOCOLVERSION>, private Listener {
+  static_assert(SIZE > 0 && SIZE < 256, "ReadPlanner size has to be between 1 and 255");
+
+ public:
+  explicit ReadPlanner(VitoWiFi<PROTOCOLVERSION>* vitoWiFi, uint8_t maxGap = 2, uint8_t maxLength = 16)
+  : _vitoWiFi(vitoWiFi)
+  , _maxGap(maxGap)
+  , _maxLength(maxLength)
+  , _datapoints()
+  , _numDatapoints(0)
+  , _blocks()
+  , _numBlocks(0)
+  , _nextBlock(0)
+  , _sequence(0)
+  , _planned(false)
+  , _splitPacket() {
+    _vitoWiFi->addListener(this);
+  }
+  ~ReadPlanner() {
+    _vitoWiFi->removeListener(this);
+  }
+  ReadPlanner(const ReadPlanner&) = delete;
+  ReadPlanner & operator=(const ReadPlanner&) = delete;
+
+  // Returns false when the planner is full or when a read cycle is running.
+  bool add(const Datapoint& datapoint) {
+    if (_numDatapoints == SIZE || isBusy() || !datapoint) return false;
+    _datapoints[_numDatapoints++] = &datapoint;
+    _planned = false;
+    return true;
+  }
+
+  void clear() {
+    _numDatapoints = 0;
+    _numBlocks = 0;
+    _nextBlock = 0;
+    _planned = true;
+  }
+
+  // Starts reading all datapoints. Returns false when the previous cycle is still being submitted.
+  bool read() {
+    if (isBusy()) return false;
+    if (!_planned) _plan();
+    _nextBlock = 0;
+    loop();
+    return true;
+  }
+
+  // Submits the remaining blocks as soon as VitoWiFi accepts them.
+  // Blocks are background reads so other requests overtake them.
+  void loop() {
+    while (_nextBlock < _numBlocks) {
+      Block& block = _blocks[_nextBlock];
+      if (block.inFlight == 0) {
+        snprintf(block.tag, sizeof(block.tag), "block %u", static_cast<unsigned int>(_sequence));
+      }
+      if (!_vitoWiFi->read(Datapoint(block.tag, block.address, block.length, noconv), Priority::BACKGROUND)) {
+        break;
+      }
+      ++block.inFlight;
+      ++_sequence;
+      ++_nextBlock;
+    }
+  }
+
+  bool isBusy() const {
+    return _nextBlock < _numBlocks;
+  }
+
+  std::size_t numberOfBlocks() {
+    if (!_planned) _plan();
+    return _numBlocks;
+  }
+
+ private:
+  struct Block {
+    uint16_t address;
+    uint8_t length;
+    uint8_t first;  // index into _datapoints
+    uint8_t count;
+    uint8_t inFlight;  // submitted reads without response or error
+    char tag[10];  // name of the submitted reads, with the sequence number of the first one in flight
+  };
+
+  VitoWiFi<PROTOCOLVERSION>* _vitoWiFi;
+  uint8_t _maxGap;
+  uint8_t _maxLength;
+  const Datapoint* _datapoints[SIZE];
+  std::size_t _numDatapoints;
+  Block _blocks[SIZE];
+  std::size_t _numBlocks;
+  std::size_t _nextBlock;
+  uint8_t _sequence;
+  bool _planned;
+  VitoWiFiInternals::EnginePacketVS2 _splitPacket;
+
+  // sort datapoints by address and merge them greedily into blocks
+  void _plan() {
+    for (std::size_t i = 1; i < _numDatapoints; ++i) {
+      const Datapoint* datapoint = _datapoints[i];
+      std::size_t j = i;
+      while (j > 0 && _datapoints[j - 1]->address() > datapoint->address()) {
+        _datapoints[j] = _datapoints[j - 1];
+        --j;
+      }
+      _datapoints[j] = datapoint;
+    }
+    _numBlocks = 0;
+    uint32_t blockEnd = 0;
+    for (std::size_t i = 0; i < _numDatapoints; ++i) {
+      uint32_t start = _datapoints[i]->address();
+      uint32_t end = start + _datapoints[i]->length();
+      if (_numBlocks > 0) {
+        Block& block = _blocks[_numBlocks - 1];
+        uint32_t newEnd = (end > blockEnd) ? end : blockEnd;
+        if (start <= blockEnd + _maxGap && newEnd - block.address <= _maxLength) {
+          blockEnd = newEnd;
+          block.length = blockEnd - block.address;
+          ++block.count;
+          continue;
+        }
+      }
+      Block& block = _blocks[_numBlocks++];
+      block.address = start;
+      block.length = _datapoints[i]->length();
+      block.first = i;
+      block.count = 1;
+      block.inFlight = 0;
+      block.tag[0] = '\0';
+      blockEnd = end;
+    }
+    _nextBlock = _numBlocks;
+    _planned = true;
+    vw_log_i("%u datapoints planned in %u blocks", static_cast<unsigned int>(_numDatapoints), static_cast<unsigned int>(_numBlocks));
+  }
+
+  // only reads submitted by this planner match: their name points into the block record
+  const Block* _findBlock(const Datapoint& request) {
+    for (std::size_t i = 0; i < _numBlocks; ++i) {
+      Block& block = _blocks[i];
+      if (request.name() == block.tag &&
+          request.address() == block.address &&
+          request.length() == block.length &&
+          block.inFlight > 0) {
+        --block.inFlight;
+        return &block;
+      }
+    }
+    return nullptr;
+  }
+
+  void handleResponse(const PacketVS2& response, const Datapoint& request) override {
+    const Block* block = _findBlock(request);
+    if (!block) {
+      this->_emitResponse(response, request);
+      return;
+    }
+    if (!response.data() || response.dataLength() < block->length) {
+      _failBlock(*block, OptolinkResult::LENGTH);
+      return;
+    }
+    for (std::size_t i = block->first; i < block->first + block->count; ++i) {
+      const Datapoint& datapoint = *_datapoints[i];
+      if (_splitPacket.createPacket(response.packetType(),
+                                    response.functionCode(),
+                                    response.id(),
+                                    datapoint.address(),
+                                    datapoint.length(),
+                                    &response.data()[datapoint.address() - block->address])) {
+        this->_emitResponse(_splitPacket, datapoint);
+      } else {
+        this->_emitError(OptolinkResult::ERROR, datapoint);
+      }
+    }
+  }
+
+  void handleResponse(const uint8_t* data, uint8_t length, const Datapoint& request) override {
+    const Block* block = _findBlock(request);
+    if (!block) {
+      this->_emitResponse(data, length, request);
+      return;
+    }
+    if (length < block->length) {
+      _failBlock(*block, OptolinkResult::LENGTH);
+      return;
+    }
+    for (std::size_t i = block->first; i < block->first + block->count; ++i) {
+      const Datapoint& datapoint = *_datapoints[i];
+      this->_emitResponse(&data[datapoint.address() - block->address], datapoint.length(), datapoint);
+    }
+  }
+
+  void handleError(OptolinkResult error, const Datapoint& request) override {
+    const Block* block = _findBlock(request);
+    if (!block) {
+      this->_emitError(error, request);
+      return;
+    }
+    _failBlock(*block, error);
+  }
+
+  void _failBlock(const Block& block, OptolinkResult error) {
+    for (std::size_t i = block.first; i < block.first + block.count; ++i) {
+      this->_emitError(error, *_datapoints[i]);
+    }
+  }
+};
+
+}  // end namespace VitoWiFi
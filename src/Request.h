@@ -0,0 +1,41 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "Constants.h"
+#include "Datapoint/Datapoint.h"
+
+namespace VitoWiFiInternals {
+
+/*
+Queued read or write request.
+Write payloads are stored inline, limited to QUEUE_PAYLOAD_LENGTH bytes.
+superseded counts the writes that were merged into this one.
+*/
+struct Request {
+  Request()
+  : datapoint(nullptr, 0, 0, VitoWiFi::noconv)
+  , functionCode(VitoWiFi::FunctionCode::READ)
+  , enqueueTime(0)
+  , superseded(0)
+  , data() {
+    // empty
+  }
+
+  VitoWiFi::Datapoint datapoint;
+  VitoWiFi::FunctionCode functionCode;
+  uint32_t enqueueTime;
+  uint8_t superseded;
+  uint8_t data[VitoWiFi::QUEUE_PAYLOAD_LENGTH];
+};
+
+}  // end namespace VitoWiFiInternals
@@ -0,0 +1,110 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#include "RequestQueue.h"
+
+#if defined(ARDUINO)
+#include <Arduino.h>  // millis()
+#endif
+
+namespace VitoWiFiInternals {
+
+RequestQueue::RequestQueue()
+: _queues()
+, _stats() {
+  // empty
+}
+
+Request* RequestQueue::acquire(VitoWiFi::Priority priority) {
+  std::size_t index = static_cast<std::size_t>(priority);
+  Request* request = _queues[index].acquire();
+  VitoWiFi::QueueStats& stats = _stats[index];
+  if (!request) {
+    ++stats.rejected;
+    return nullptr;
+  }
+  request->enqueueTime = vw_millis();
+  request->superseded = 0;
+  ++stats.enqueued;
+  stats.depth = _queues[index].size();
+  if (stats.depth > stats.maxDepth) stats.maxDepth = stats.depth;
+  return request;
+}
+
+Request* RequestQueue::acquireWrite(const VitoWiFi::Datapoint& datapoint, VitoWiFi::Priority priority) {
+  std::size_t index = static_cast<std::size_t>(priority);
+  Queue<Request, VitoWiFi::QUEUE_SIZE>& queue = _queues[index];
+  for (std::size_t i = 0; i < queue.size(); ++i) {
+    Request& request = queue[i];
+    if (request.functionCode == VitoWiFi::FunctionCode::WRITE &&
+        request.datapoint.address() == datapoint.address() &&
+        request.datapoint.length() == datapoint.length() &&
+        request.superseded < UINT8_MAX) {
+      ++request.superseded;
+      ++_stats[index].coalesced;
+      return &request;
+    }
+  }
+  return acquire(priority);
+}
+
+Request& RequestQueue::front() {
+  return _queues[_frontIndex()].front();
+}
+
+void RequestQueue::pop() {
+  std::size_t index = _frontIndex();
+  if (_queues[index].empty()) return;
+  uint32_t wait = vw_millis() - _queues[index].front().enqueueTime;
+  _queues[index].pop();
+  VitoWiFi::QueueStats& stats = _stats[index];
+  ++stats.dispatched;
+  stats.depth = _queues[index].size();
+  stats.totalWait += wait;
+  if (wait > stats.maxWait) stats.maxWait = wait;
+}
+
+void RequestQueue::drop() {
+  std::size_t index = _frontIndex();
+  if (_queues[index].empty()) return;
+  _queues[index].pop();
+  _stats[index].depth = _queues[index].size();
+}
+
+void RequestQueue::clear() {
+  for (std::size_t i = 0; i < VitoWiFi::NUMBER_OF_PRIORITIES; ++i) {
+    _queues[i].clear();
+    _stats[i].depth = 0;
+  }
+}
+
+std::size_t RequestQueue::size() const {
+  std::size_t size = 0;
+  for (std::size_t i = 0; i < VitoWiFi::NUMBER_OF_PRIORITIES; ++i) {
+    size += _queues[i].size();
+  }
+  return size;
+}
+
+bool RequestQueue::empty() const {
+  return size() == 0;
+}
+
+const VitoWiFi::QueueStats& RequestQueue::stats(VitoWiFi::Priority priority) const {
+  return _stats[static_cast<std::size_t>(priority)];
+}
+
+// highest class with a pending request, the last class when all are empty
+std::size_t RequestQueue::_frontIndex() const {
+  for (std::size_t i = 0; i < VitoWiFi::NUMBER_OF_PRIORITIES - 1; ++i) {
+    if (!_queues[i].empty()) return i;
+  }
+  return VitoWiFi::NUMBER_OF_PRIORITIES - 1;
+}
+
+}  // end namespace VitoWiFiInternals
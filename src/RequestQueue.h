@@ -0,0 +1,81 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "Constants.h"
+#include "Helpers.h"
+#include "Queue.h"
+#include "Request.h"
+
+namespace VitoWiFi {
+
+// Statistics per priority class. Times are in milliseconds.
+struct QueueStats {
+  QueueStats()
+  : enqueued(0)
+  , dispatched(0)
+  , rejected(0)
+  , coalesced(0)
+  , depth(0)
+  , maxDepth(0)
+  , totalWait(0)
+  , maxWait(0) {
+    // empty
+  }
+
+  uint32_t enqueued;
+  uint32_t dispatched;
+  uint32_t rejected;  // queue was full
+  uint32_t coalesced;  // writes merged into a queued write
+  uint8_t depth;
+  uint8_t maxDepth;
+  uint32_t totalWait;  // from enqueueing until the request is taken for sending
+  uint32_t maxWait;
+};
+
+}  // end namespace VitoWiFi
+
+namespace VitoWiFiInternals {
+
+/*
+One FIFO queue per priority class. Requests are taken from the highest
+class that is not empty, so a higher class overtakes lower classes at the
+next transaction.
+*/
+class RequestQueue {
+ public:
+  RequestQueue();
+
+  // Returns nullptr when the queue of this class is full.
+  Request* acquire(VitoWiFi::Priority priority);
+  // Returns the queued write to the same datapoint if there is one, so the new value replaces the queued value.
+  // Otherwise like acquire.
+  Request* acquireWrite(const VitoWiFi::Datapoint& datapoint, VitoWiFi::Priority priority);
+  // Request to be sent next. Only valid when not empty.
+  Request& front();
+  void pop();
+  // Removes the request to be sent next without counting it as dispatched.
+  void drop();
+  void clear();
+
+  std::size_t size() const;
+  bool empty() const;
+  const VitoWiFi::QueueStats& stats(VitoWiFi::Priority priority) const;
+
+ private:
+  Queue<Request, VitoWiFi::QUEUE_SIZE> _queues[VitoWiFi::NUMBER_OF_PRIORITIES];
+  VitoWiFi::QueueStats _stats[VitoWiFi::NUMBER_OF_PRIORITIES];
+
+  std::size_t _frontIndex() const;
+};
+
+}  // end namespace VitoWiFiInternals
@@ -0,0 +1,218 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include "Constants.h"
+#include "Helpers.h"
+#include "Listener.h"
+#include "Logging.h"
+#include "Queue.h"
+#include "Datapoint/Datapoint.h"
+#include "VS2/PacketVS2.h"
+
+namespace VitoWiFi {
+
+template <class PROTOCOLVERSION>
+class VitoWiFi;
+
+/*
+Remembers the last response per datapoint. A read of a datapoint whose
+cached value is younger than its time-to-live (ms) is answered from memory
+without using the Optolink. Other reads go to VitoWiFi.
+Cached answers are dispatched from loop(), like regular responses.
+
+Only responses to reads made through the cache are stored. Writes through
+the cache and any other response or error of a registered datapoint drop
+its cached value: VS1 and GWG don't tell read and write responses apart.
+Datapoints longer than MAX_LENGTH bytes aren't cached.
+*/
+template <class PROTOCOLVERSION, std::size_t SIZE, std::size_t MAX_LENGTH = 8>
+class ResponseCache : public Source<PROTOCOLVERSION>, private Listener {
+  static_assert(SIZE > 0 && SIZE < 256, "ResponseCache size has to be between 1 and 255");
+
+ public:
+  explicit ResponseCache(VitoWiFi<PROTOCOLVERSION>* vitoWiFi)
+  : _vitoWiFi(vitoWiFi)
+  , _entries()
+  , _numEntries(0)
+  , _hits()
+  , _hitCount(0)
+  , _missCount(0)
+  , _packet() {
+    _vitoWiFi->addListener(this);
+  }
+  ~ResponseCache() {
+    _vitoWiFi->removeListener(this);
+  }
+  ResponseCache(const ResponseCache&) = delete;
+  ResponseCache & operator=(const ResponseCache&) = delete;
+
+  // Caches responses of datapoint for ttl milliseconds. Returns false when full or when too long.
+  bool add(const Datapoint& datapoint, uint32_t ttl) {
+    if (_numEntries == SIZE || !datapoint || datapoint.length() > MAX_LENGTH) return false;
+    Entry& entry = _entries[_numEntries++];
+    entry.address = datapoint.address();
+    entry.length = datapoint.length();
+    entry.ttl = ttl;
+    entry.valid = false;
+    entry.pending = false;
+    return true;
+  }
+
+  // Forgets all cached values, the datapoints stay registered.
+  void invalidate() {
+    for (std::size_t i = 0; i < _numEntries; ++i) {
+      _entries[i].valid = false;
+    }
+  }
+
+  bool read(const Datapoint& datapoint, Priority priority = Priority::INTERACTIVE_READ) {
+    std::size_t index = VitoWiFiInternals::indexOf(_entries, _numEntries, datapoint);
+    if (index < _numEntries && _isFresh(_entries[index])) {
+      Hit* hit = _hits.acquire();
+      if (hit) {
+        hit->datapoint = datapoint;
+        hit->index = index;
+        ++_hitCount;
+        return true;
+      }
+    }
+    ++_missCount;
+    if (!_vitoWiFi->read(datapoint, priority)) return false;
+    if (index < _numEntries) _entries[index].pending = true;
+    return true;
+  }
+
+  // Writes always go to VitoWiFi and drop the cached value.
+  template <typename T>
+  bool write(const Datapoint& datapoint, T value, Priority priority = Priority::INTERACTIVE_WRITE) {
+    _forget(datapoint);
+    return _vitoWiFi->write(datapoint, value, priority);
+  }
+
+  bool write(const Datapoint& datapoint, const uint8_t* data, uint8_t length, Priority priority = Priority::INTERACTIVE_WRITE) {
+    _forget(datapoint);
+    return _vitoWiFi->write(datapoint, data, length, priority);
+  }
+
+  bool write(const Datapoint& datapoint, const uint8_t* data, Priority priority = Priority::INTERACTIVE_WRITE) {
+    return write(datapoint, data, datapoint.length(), priority);
+  }
+
+  // Dispatches the cached answers.
+  void loop() {
+    while (!_hits.empty()) {
+      Hit hit = _hits.front();
+      _hits.pop();
+      const Entry& entry = _entries[hit.index];
+      _dispatch(hit.datapoint, entry.data, entry.length);
+    }
+  }
+
+  uint32_t hits() const {
+    return _hitCount;
+  }
+
+  uint32_t misses() const {
+    return _missCount;
+  }
+
+ private:
+  struct Entry {
+    uint16_t address;
+    uint8_t length;
+    uint32_t ttl;
+    uint32_t timestamp;
+    bool valid;
+    bool pending;  // a read through the cache is waiting for its response
+    uint8_t data[MAX_LENGTH];
+  };
+
+  struct Hit {
+    Hit()
+    : datapoint(nullptr, 0, 0, noconv)
+    , index(0) {}
+    Datapoint datapoint;
+    std::size_t index;
+  };
+
+  VitoWiFi<PROTOCOLVERSION>* _vitoWiFi;
+  Entry _entries[SIZE];
+  std::size_t _numEntries;
+  VitoWiFiInternals::Queue<Hit, QUEUE_SIZE> _hits;
+  uint32_t _hitCount;
+  uint32_t _missCount;
+  VitoWiFiInternals::EnginePacketVS2 _packet;
+
+  void handleResponse(const PacketVS2& response, const Datapoint& request) override {
+    if (response.functionCode() == FunctionCode::READ) {
+      _store(request, response.data(), response.dataLength());
+    } else {
+      _forget(request);
+    }
+    this->_emitResponse(response, request);
+  }
+
+  void handleResponse(const uint8_t* data, uint8_t length, const Datapoint& request) override {
+    _store(request, data, length);
+    this->_emitResponse(data, length, request);
+  }
+
+  void handleError(OptolinkResult error, const Datapoint& request) override {
+    _forget(request);
+    this->_emitError(error, request);
+  }
+
+  bool _isFresh(const Entry& entry) const {
+    return entry.valid && vw_millis() - entry.timestamp < entry.ttl;
+  }
+
+  // responses to reads that didn't go through the cache may answer a write
+  void _store(const Datapoint& request, const uint8_t* data, uint8_t length) {
+    std::size_t index = VitoWiFiInternals::indexOf(_entries, _numEntries, request);
+    if (index == _numEntries) return;
+    Entry& entry = _entries[index];
+    if (!entry.pending || !data || length != entry.length) {
+      _forget(request);
+      return;
+    }
+    entry.pending = false;
+    std::memcpy(entry.data, data, length);
+    entry.timestamp = vw_millis();
+    entry.valid = true;
+  }
+
+  void _forget(const Datapoint& datapoint) {
+    std::size_t index = VitoWiFiInternals::indexOf(_entries, _numEntries, datapoint);
+    if (index == _numEntries) return;
+    _entries[index].valid = false;
+    _entries[index].pending = false;
+  }
+
+  // cached answers are presented like a regular response of the protocol
+  void _dispatch(const Datapoint& datapoint, const uint8_t* data, uint8_t length) {
+    _dispatch(datapoint, data, length, static_cast<const typename PROTOCOLVERSION::OnResponseCallback*>(nullptr));
+  }
+
+  void _dispatch(const Datapoint& datapoint, const uint8_t* data, uint8_t length, const VitoWiFiInternals::PacketCallback*) {
+    if (_packet.createPacket(PacketType::RESPONSE, FunctionCode::READ, 0, datapoint.address(), length, data)) {
+      this->_emitResponse(_packet, datapoint);
+    }
+  }
+
+  void _dispatch(const Datapoint& datapoint, const uint8_t* data, uint8_t length, const VitoWiFiInternals::DataCallback*) {
+    this->_emitResponse(data, length, datapoint);
+  }
+};
+
+}  // end namespace VitoWiFi
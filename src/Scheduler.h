@@ -0,0 +1,194 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "Constants.h"
+#include "Helpers.h"
+#include "Listener.h"
+#include "Logging.h"
+#include "Datapoint/Datapoint.h"
+#include "VS2/PacketVS2.h"
+
+namespace VitoWiFi {
+
+template <class PROTOCOLVERSION>
+class VitoWiFi;
+
+/*
+Keeps datapoints fresh: every datapoint has a maximum age in milliseconds.
+Reads are ordered earliest deadline first. A read is started when the
+deadline is closer than the time needed to read all datapoints once, so
+every datapoint still fits in when the bus is fully loaded.
+
+The round trip time is measured per datapoint. The sum of rtt / maximum age
+over all datapoints is the bus utilization: above 1 not every deadline can
+be met. Deadlines that pass without a fresh value are counted as misses.
+
+Reads are only submitted when VitoWiFi is idle and as background requests.
+All responses and errors are passed through.
+Datapoints are stored by reference and have to remain valid.
+*/
+template <class PROTOCOLVERSION, std::size_t SIZE>
+class Scheduler : public Source<PROTOCOLVERSION>, private Listener {
+  static_assert(SIZE > 0, "Scheduler size has to be at least 1");
+
+ public:
+  // estimate until the first round trip has been measured
+  static constexpr uint32_t DEFAULT_RTT = 100;
+  // a submitted read is abandoned after this time
+  static constexpr uint32_t PENDING_TIMEOUT = 5000;
+
+  explicit Scheduler(VitoWiFi<PROTOCOLVERSION>* vitoWiFi)
+  : _vitoWiFi(vitoWiFi)
+  , _entries()
+  , _numEntries(0)
+  , _pending(nullptr)
+  , _pendingSince(0)
+  , _deadlineMisses(0) {
+    _vitoWiFi->addListener(this);
+  }
+  ~Scheduler() {
+    _vitoWiFi->removeListener(this);
+  }
+  Scheduler(const Scheduler&) = delete;
+  Scheduler & operator=(const Scheduler&) = delete;
+
+  // The datapoint is due immediately. Returns false when the scheduler is full.
+  bool add(const Datapoint& datapoint, uint32_t maxAge) {
+    if (_numEntries == SIZE || !datapoint || maxAge == 0) return false;
+    Entry& entry = _entries[_numEntries++];
+    entry.datapoint = &datapoint;
+    entry.address = datapoint.address();
+    entry.length = datapoint.length();
+    entry.maxAge = maxAge;
+    entry.lastUpdate = vw_millis() - maxAge;
+    entry.rtt = DEFAULT_RTT;
+    entry.missed = true;  // no value yet, don't count as miss
+    return true;
+  }
+
+  void clear() {
+    _numEntries = 0;
+    _pending = nullptr;
+  }
+
+  void loop() {
+    uint32_t now = vw_millis();
+    uint32_t cycleCost = 0;
+    for (std::size_t i = 0; i < _numEntries; ++i) {
+      Entry& entry = _entries[i];
+      cycleCost += entry.rtt;
+      if (!entry.missed && _remaining(entry, now) < 0) {
+        entry.missed = true;
+        ++_deadlineMisses;
+      }
+    }
+    if (_pending && now - _pendingSince > PENDING_TIMEOUT) {
+      _pending = nullptr;
+    }
+    if (_pending || _vitoWiFi->isBusy()) return;
+
+    // earliest deadline among the datapoints that have to be started now
+    Entry* next = nullptr;
+    for (std::size_t i = 0; i < _numEntries; ++i) {
+      Entry& entry = _entries[i];
+      int32_t remaining = _remaining(entry, now);
+      if (remaining > static_cast<int32_t>(cycleCost)) continue;
+      if (!next || remaining < _remaining(*next, now)) next = &entry;
+    }
+    if (next && _vitoWiFi->read(*next->datapoint, Priority::BACKGROUND)) {
+      _pending = next;
+      _pendingSince = now;
+    }
+  }
+
+  // Sum of rtt / maximum age. Above 1 the bus can't keep every datapoint fresh.
+  float utilization() const {
+    float retVal = 0;
+    for (std::size_t i = 0; i < _numEntries; ++i) {
+      retVal += static_cast<float>(_entries[i].rtt) / _entries[i].maxAge;
+    }
+    return retVal;
+  }
+
+  bool feasible() const {
+    return utilization() <= 1.0f;
+  }
+
+  uint32_t deadlineMisses() const {
+    return _deadlineMisses;
+  }
+
+  // Measured round trip time in milliseconds, 0 for unknown datapoints.
+  uint32_t roundTripTime(const Datapoint& datapoint) const {
+    std::size_t index = VitoWiFiInternals::indexOf(_entries, _numEntries, datapoint);
+    return (index < _numEntries) ? _entries[index].rtt : 0;
+  }
+
+ private:
+  struct Entry {
+    const Datapoint* datapoint;
+    uint16_t address;
+    uint8_t length;
+    uint32_t maxAge;
+    uint32_t lastUpdate;
+    uint32_t rtt;
+    bool missed;  // current deadline is already counted as missed
+  };
+
+  VitoWiFi<PROTOCOLVERSION>* _vitoWiFi;
+  Entry _entries[SIZE];
+  std::size_t _numEntries;
+  Entry* _pending;
+  uint32_t _pendingSince;
+  uint32_t _deadlineMisses;
+
+  // milliseconds until the deadline, negative when passed
+  static int32_t _remaining(const Entry& entry, uint32_t now) {
+    return static_cast<int32_t>(entry.lastUpdate + entry.maxAge - now);
+  }
+
+  void handleResponse(const PacketVS2& response, const Datapoint& request) override {
+    _onUpdate(request);
+    this->_emitResponse(response, request);
+  }
+
+  void handleResponse(const uint8_t* data, uint8_t length, const Datapoint& request) override {
+    _onUpdate(request);
+    this->_emitResponse(data, length, request);
+  }
+
+  // any response for the datapoint refreshes it, not only the reads we submitted
+  void _onUpdate(const Datapoint& request) {
+    std::size_t index = VitoWiFiInternals::indexOf(_entries, _numEntries, request);
+    if (index == _numEntries) return;
+    Entry* entry = &_entries[index];
+    uint32_t now = vw_millis();
+    if (entry == _pending) {
+      // moving average
+      uint32_t sample = now - _pendingSince;
+      entry->rtt = (3 * entry->rtt + sample) / 4;
+      _pending = nullptr;
+    }
+    entry->lastUpdate = now;
+    entry->missed = false;
+  }
+
+  void handleError(OptolinkResult error, const Datapoint& request) override {
+    if (_pending && VitoWiFiInternals::indexOf(_entries, _numEntries, request) == static_cast<std::size_t>(_pending - _entries)) {
+      _pending = nullptr;
+    }
+    this->_emitError(error, request);
+  }
+};
+
+}  // end namespace VitoWiFi
@@ -12,7 +12,8 @@ namespace VitoWiFi {
 
 PacketVS1::PacketVS1()
 : _allocatedLength(START_PAYLOAD_LENGTH + 4)
-, _buffer(nullptr) {
+, _buffer(nullptr)
+, _ownsBuffer(true) {
   _buffer = reinterpret_cast<uint8_t*>(malloc(_allocatedLength));
   if (!_buffer) {
     _allocatedLength = 0;
@@ -21,8 +22,15 @@ PacketVS1::PacketVS1()
   reset();
 }
 
+PacketVS1::PacketVS1(uint8_t* buffer, std::size_t size)
+: _allocatedLength(size)
+, _buffer(buffer)
+, _ownsBuffer(false) {
+  reset();
+}
+
 PacketVS1::~PacketVS1() {
-  free(_buffer);
+  if (_ownsBuffer) free(_buffer);
 }
 
 PacketVS1::operator bool() const {
@@ -57,6 +65,10 @@ bool PacketVS1::createPacket(uint8_t packetType, uint16_t addr, uint8_t len, con
   // reserve memory
   std::size_t toAllocate = (packetType == PacketVS1Type.WRITE) ? len + 4 : 4;
   if (toAllocate > _allocatedLength) {
+    if (!_ownsBuffer) {
+      vw_log_w("Packet too large: %u bytes", static_cast<unsigned int>(toAllocate));
+      return false;
+    }
     uint8_t* newBuffer = reinterpret_cast<uint8_t*>(realloc(_buffer, toAllocate));
     if (!newBuffer) {
       return false;
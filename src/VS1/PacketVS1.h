@@ -40,8 +40,35 @@ class PacketVS1 {
   void reset();
 
  protected:
+  PacketVS1(uint8_t* buffer, std::size_t size);
   std::size_t _allocatedLength;
   uint8_t* _buffer;
+  bool _ownsBuffer;
+};
+
+/*
+PacketVS1 with inline storage for payloads up to PAYLOAD_CAPACITY bytes.
+Never allocates: packets that don't fit are refused.
+*/
+template <std::size_t PAYLOAD_CAPACITY>
+class StaticPacketVS1 : private VitoWiFiInternals::PacketStorage<PAYLOAD_CAPACITY + 4>, public PacketVS1 {
+ public:
+  StaticPacketVS1()
+  : VitoWiFiInternals::PacketStorage<PAYLOAD_CAPACITY + 4>()
+  , PacketVS1(this->_storage, PAYLOAD_CAPACITY + 4) {
+    // empty
+  }
 };
 
 }  // end namespace VitoWiFi
+
+namespace VitoWiFiInternals {
+
+// packet type used by the protocol implementations, see VW_STATIC_PAYLOAD_LENGTH
+#if defined(VW_STATIC_PAYLOAD_LENGTH)
+typedef VitoWiFi::StaticPacketVS1<VitoWiFi::STATIC_PAYLOAD_LENGTH> EnginePacketVS1;
+#else
+typedef VitoWiFi::PacketVS1 EnginePacketVS1;
+#endif
+
+}  // end namespace VitoWiFiInternals
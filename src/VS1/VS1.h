@@ -13,6 +13,9 @@ the LICENSE file.
 #include "Logging.h"
 #include "../Constants.h"
 #include "../Helpers.h"
+#include "../RequestQueue.h"
+#include "../LinkMetrics.h"
+#include "../LatencyHistograms.h"
 #include "PacketVS1.h"
 #include "../Datapoint/Datapoint.h"
 #if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_ESP32)
@@ -47,24 +50,27 @@ class VS1 {
   , _lastMillis(_currentMillis)
   , _requestTime(0)
   , _bytesTransferred(0)
+  , _isWrite(false)
   , _interface(nullptr)
   , _currentDatapoint(Datapoint(nullptr, 0x0000, 0, VitoWiFi::noconv))
   , _currentRequest()
+  , _queue()
   , _responseBuffer(nullptr)
   , _allocatedLength(0)
   , _onResponseCallback(nullptr)
-  , _onErrorCallback(nullptr) {
+  , _onErrorCallback(nullptr)
+  , _metrics()
+  , _stateSince(_currentMillis)
+  , _synced(false)
+  , _latencyRecorder(nullptr)
+  , _times() {
     assert(interface != nullptr);
     _interface = new(std::nothrow) VitoWiFiInternals::GenericInterface<C>(interface);
     if (!_interface) {
       vw_log_e("Could not create serial interface");
       vw_abort();
     }
-    _responseBuffer = reinterpret_cast<uint8_t*>(malloc(START_PAYLOAD_LENGTH));
-    if (!_responseBuffer) {
-      vw_log_e("Could not create response buffer");
-      vw_abort();
-    }
+    _createResponseBuffer();
   }
   ~VS1();
   VS1(const VS1&) = delete;
@@ -73,9 +79,9 @@ class VS1 {
   void onResponse(OnResponseCallback callback);
   void onError(OnErrorCallback callback);
 
-  bool read(const Datapoint& datapoint);
-  bool write(const Datapoint& datapoint, const VariantValue& value);
-  bool write(const Datapoint& datapoint, const uint8_t* data, uint8_t length);
+  bool read(const Datapoint& datapoint, Priority priority = Priority::INTERACTIVE_READ);
+  bool write(const Datapoint& datapoint, const VariantValue& value, Priority priority = Priority::INTERACTIVE_WRITE);
+  bool write(const Datapoint& datapoint, const uint8_t* data, uint8_t length, Priority priority = Priority::INTERACTIVE_WRITE);
 
   bool begin();
   void loop();
@@ -83,6 +89,14 @@ class VS1 {
 
   int getState() const;
   bool isBusy() const;
+  const QueueStats& queueStats(Priority priority) const;
+  LinkMetrics metrics() const;
+  // recorder receives the latencies of every finished request, nullptr to stop
+  void setLatencyRecorder(LatencyRecorder* recorder);
+
+  // for event loops: wait until fd() is readable or nextTimeout() milliseconds have passed, then call loop()
+  int fd() const;
+  uint32_t nextTimeout() const;
 
  private:
   enum class State {
@@ -97,15 +111,28 @@ class VS1 {
   uint32_t _lastMillis;
   uint32_t _requestTime;
   uint8_t _bytesTransferred;
+  bool _isWrite;  // of _currentDatapoint, the controller confirms a write with one byte
   VitoWiFiInternals::SerialInterface* _interface;
   Datapoint _currentDatapoint;
-  PacketVS1 _currentRequest;
+  VitoWiFiInternals::EnginePacketVS1 _currentRequest;
+  VitoWiFiInternals::RequestQueue _queue;
   uint8_t* _responseBuffer;
   uint8_t _allocatedLength;
+  #if defined(VW_STATIC_PAYLOAD_LENGTH)
+  uint8_t _responseStorage[STATIC_PAYLOAD_LENGTH];
+  #endif
   OnResponseCallback _onResponseCallback;
   OnErrorCallback _onErrorCallback;
+  LinkMetrics _metrics;
+  uint32_t _stateSince;
+  bool _synced;  // false until the first handshake after begin(), a reset or a timeout
+  LatencyRecorder* _latencyRecorder;
+  VitoWiFiInternals::RequestTimes _times;  // of _currentDatapoint
 
   inline void _setState(State state);
+  VitoWiFiInternals::Request* _acquireWrite(const Datapoint& datapoint, uint8_t length, Priority priority);
+  bool _nextRequest();
+  std::size_t _write(const uint8_t* data, uint8_t length);
 
   void _init();
   void _syncEnq();
@@ -115,7 +142,9 @@ class VS1 {
 
   void _tryOnResponse();
   void _tryOnError(OptolinkResult result);
+  void _tryOnError(OptolinkResult result, const Datapoint& datapoint);
 
+  void _createResponseBuffer();
   bool _expandResponseBuffer(uint8_t newSize);
 };
 
@@ -12,7 +12,10 @@ namespace VitoWiFi {
 
 PacketVS2::PacketVS2()
 : _allocatedLength(START_PAYLOAD_LENGTH + 6)
-, _buffer(nullptr) {
+, _buffer(nullptr)
+, _ownsBuffer(true)
+, _checksum(0)
+, _checksumValid(true) {
   _buffer = reinterpret_cast<uint8_t*>(malloc(_allocatedLength));
   if (!_buffer) {
     _allocatedLength = 0;
@@ -21,8 +24,17 @@ PacketVS2::PacketVS2()
   reset();
 }
 
+PacketVS2::PacketVS2(uint8_t* buffer, std::size_t size)
+: _allocatedLength(size)
+, _buffer(buffer)
+, _ownsBuffer(false)
+, _checksum(0)
+, _checksumValid(true) {
+  reset();
+}
+
 PacketVS2::~PacketVS2() {
-  free(_buffer);
+  if (_ownsBuffer) free(_buffer);
 }
 
 PacketVS2::operator bool() const {
@@ -30,13 +42,12 @@ PacketVS2::operator bool() const {
   return false;
 }
 
-/*
-uint8_t PacketVS2::operator[](std::size_t index) const {
+const uint8_t& PacketVS2::operator[](std::size_t index) const {
   return _buffer[index];
 }
-*/
 
 uint8_t& PacketVS2::operator[](std::size_t index) {
+  _checksumValid = false;
   return _buffer[index];
 }
 
@@ -48,7 +59,13 @@ bool PacketVS2::createPacket(PacketType pt, FunctionCode fc, uint8_t id, uint16_
     vw_log_w("Length error: %u", len);
     return false;
   }
-  if (fc == FunctionCode::WRITE && !data) {
+  // write requests and read responses carry a data payload
+  bool hasPayload = (fc == FunctionCode::WRITE) ? (pt == PacketType::REQUEST) : (pt == PacketType::RESPONSE);
+  if (hasPayload && len > 250) {
+    vw_log_w("Length error: %u > 250", len);
+    return false;
+  }
+  if (hasPayload && !data) {
     vw_log_w("Function code - data mismatch");
     return false;
   }
@@ -57,8 +74,12 @@ bool PacketVS2::createPacket(PacketType pt, FunctionCode fc, uint8_t id, uint16_
   }
 
   // reserve memory
-  std::size_t toAllocate = (fc == FunctionCode::WRITE) ? len + 6 : 6;
+  std::size_t toAllocate = hasPayload ? len + 6 : 6;
   if (toAllocate > _allocatedLength) {
+    if (!_ownsBuffer) {
+      vw_log_w("Packet too large: %u bytes", static_cast<unsigned int>(toAllocate));
+      return false;
+    }
     uint8_t* newBuffer = reinterpret_cast<uint8_t*>(realloc(_buffer, toAllocate));
     if (!newBuffer) {
       vw_log_e("buffer not available");
@@ -68,9 +89,9 @@ bool PacketVS2::createPacket(PacketType pt, FunctionCode fc, uint8_t id, uint16_
     _allocatedLength = toAllocate;
   }
 
-  // 2. Serialize into buffer
+  // 2. Serialize into buffer, summing up the checksum on the way
   size_t step = 0;
-  if (fc == FunctionCode::WRITE) {
+  if (hasPayload) {
     _buffer[step++] = 0x05 + len;  // 0x05 = standard length: mt, fc, addr(2), len + data
   } else {
     _buffer[step++] = 0x05;
@@ -80,17 +101,27 @@ bool PacketVS2::createPacket(PacketType pt, FunctionCode fc, uint8_t id, uint16_
   _buffer[step++] = (addr >> 8) & 0xFF;
   _buffer[step++] = addr & 0xFF;
   _buffer[step++] = len;
-  if (fc == FunctionCode::WRITE || pt == PacketType::RESPONSE) {
+  _checksum = 0;
+  for (std::size_t i = 0; i < step; ++i) {
+    _checksum += _buffer[i];
+  }
+  if (hasPayload) {
     for (uint8_t i = 0; i < len; ++i) {
+      _checksum += data[i];
       _buffer[step++] = data[i];
     }
   }
+  _checksumValid = true;
   return true;
 }
 
 bool PacketVS2::setLength(uint8_t length) {
   std::size_t toAllocate = length + 1;
   if (toAllocate > _allocatedLength) {
+    if (!_ownsBuffer) {
+      vw_log_w("Packet too large: %u bytes", static_cast<unsigned int>(toAllocate));
+      return false;
+    }
     uint8_t* newBuffer = reinterpret_cast<uint8_t*>(realloc(_buffer, toAllocate));
     if (!newBuffer) {
       return false;
@@ -99,6 +130,7 @@ bool PacketVS2::setLength(uint8_t length) {
     _buffer = newBuffer;
   }
   _buffer[0] = length;
+  _checksumValid = false;
   return true;
 }
 
@@ -133,16 +165,22 @@ const uint8_t* PacketVS2::data() const {
   return &_buffer[6];
 }
 
+// checksum as calculated by createPacket() or by the parser, recalculated after changes through operator[]
 uint8_t PacketVS2::checksum() const {
-  uint8_t retVal = 0;
-  for (std::size_t i = 0; i <= _buffer[0]; ++i) {
-    retVal += _buffer[i];
+  if (!_checksumValid) {
+    _checksum = 0;
+    for (std::size_t i = 0; i <= _buffer[0]; ++i) {
+      _checksum += _buffer[i];
+    }
+    _checksumValid = true;
   }
-  return retVal;
+  return _checksum;
 }
 
 void PacketVS2::reset() {
   _buffer[0] = 0x00;
+  _checksum = 0;
+  _checksumValid = true;
 }
 
 }  // end namespace VitoWiFi
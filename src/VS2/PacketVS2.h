@@ -34,7 +34,7 @@ class PacketVS2 {
   PacketVS2 (const PacketVS2&) = delete;
   PacketVS2& operator =(const PacketVS2&) = delete;
   operator bool() const;
-  /* uint8_t operator[](std::size_t index) const; */
+  const uint8_t& operator[](std::size_t index) const;
   uint8_t& operator[](std::size_t index);
 
  public:
@@ -53,8 +53,37 @@ class PacketVS2 {
   void reset();
 
  protected:
+  PacketVS2(uint8_t* buffer, std::size_t size);
   std::size_t _allocatedLength;
   uint8_t* _buffer;
+  bool _ownsBuffer;
+  mutable uint8_t _checksum;
+  mutable bool _checksumValid;  // cleared when the buffer is handed out through operator[]
+};
+
+/*
+PacketVS2 with inline storage for payloads up to PAYLOAD_CAPACITY bytes.
+Never allocates: packets that don't fit are refused.
+*/
+template <std::size_t PAYLOAD_CAPACITY>
+class StaticPacketVS2 : private VitoWiFiInternals::PacketStorage<PAYLOAD_CAPACITY + 6>, public PacketVS2 {
+ public:
+  StaticPacketVS2()
+  : VitoWiFiInternals::PacketStorage<PAYLOAD_CAPACITY + 6>()
+  , PacketVS2(this->_storage, PAYLOAD_CAPACITY + 6) {
+    // empty
+  }
 };
 
 }  // end namespace VitoWiFi
+
+namespace VitoWiFiInternals {
+
+// packet type used by the protocol implementations, see VW_STATIC_PAYLOAD_LENGTH
+#if defined(VW_STATIC_PAYLOAD_LENGTH)
+typedef VitoWiFi::StaticPacketVS2<VitoWiFi::STATIC_PAYLOAD_LENGTH> EnginePacketVS2;
+#else
+typedef VitoWiFi::PacketVS2 EnginePacketVS2;
+#endif
+
+}  // end namespace VitoWiFiInternals
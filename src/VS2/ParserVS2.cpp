@@ -8,36 +8,56 @@ the LICENSE file.
 
 #include "ParserVS2.h"
 
+#include <cstring>
+
 namespace VitoWiFiInternals {
 
 ParserVS2::ParserVS2()
 : _packet()
 , _step(ParserStep::STARTBYTE)
-, _payloadLength(0) {
+, _payloadLength(0)
+, _checksum(0)
+, _window()
+, _windowLength(0)
+, _skipped(0)
+, _resyncs(0) {
   // empty
 }
 
 ParserResult ParserVS2::parse(const uint8_t b) {
+  // running checksum: everything between start byte and checksum
+  if (_step != ParserStep::STARTBYTE && _step != ParserStep::CHECKSUM) {
+    _checksum += b;
+  }
+  // keep the header bytes for resynchronisation
+  if (_step != ParserStep::STARTBYTE && _windowLength < sizeof(_window)) {
+    _window[_windowLength++] = b;
+  }
   switch (_step) {
   case ParserStep::STARTBYTE:
     if (b != ProtocolBytes.PACKETSTART) {
-      vw_log_w("Invalid packet start: 0x%02x", b);
+      ++_skipped;  // logged once when the next packet starts
       break;
     }
+    if (_skipped > 0) {
+      vw_log_w("Skipped %u bytes before packet start", static_cast<unsigned int>(_skipped));
+      _skipped = 0;
+      ++_resyncs;
+    }
     _packet.reset();
+    _checksum = 0;
+    _windowLength = 0;
     _step = ParserStep::PACKETLENGTH;
     break;
 
   case ParserStep::PACKETLENGTH:
     if (b < 5) {
       vw_log_w("Invalid packet length: %u", b);
-      _step = ParserStep::STARTBYTE;
-      return ParserResult::ERROR;
+      return _resync();
     }
     if (!_packet.setLength(b)) {
       vw_log_e("Could not parse packet");
-      _step = ParserStep::STARTBYTE;
-      return ParserResult::ERROR;
+      return _resync();
     }
     _step = ParserStep::PACKETTYPE;
     break;
@@ -45,8 +65,7 @@ ParserResult ParserVS2::parse(const uint8_t b) {
   case ParserStep::PACKETTYPE:
     if (b > 0x03) {
       vw_log_w("Invalid packet type: 0x%02x", b);
-      _step = ParserStep::STARTBYTE;
-      return ParserResult::ERROR;
+      return _resync();
     }
     _packet[1] = b;
     _step = ParserStep::FLAGS;
@@ -57,8 +76,7 @@ ParserResult ParserVS2::parse(const uint8_t b) {
     uint8_t fc = b & 0x1F;
     if (fc != 0x01 && fc != 0x02 && fc != 0x07) {
       vw_log_w("Invalid packet fc: 0x%02x", fc);
-      _step = ParserStep::STARTBYTE;
-      return ParserResult::ERROR;
+      return _resync();
     }
     }
     _packet[2] = b;
@@ -86,8 +104,7 @@ ParserResult ParserVS2::parse(const uint8_t b) {
     } else {
       if (b != _packet.length() - 6U) {
         vw_log_w("Invalid payload length: %u (expected %u)", b, _packet.length() - 6U);
-        _step = ParserStep::STARTBYTE;
-        return ParserResult::ERROR;
+        return _resync();
       }
       _payloadLength = b;
       _step = ParserStep::PAYLOAD;
@@ -102,19 +119,85 @@ ParserResult ParserVS2::parse(const uint8_t b) {
     break;
 
   case ParserStep::CHECKSUM:
-    if (_packet.checksum() != b) {
-      vw_log_w("Invalid checksum: 0x%02x (calculated 0x%02x)", b, _packet.checksum());
-      _step = ParserStep::STARTBYTE;
+    _step = ParserStep::STARTBYTE;
+    if (_checksum != b) {
+      vw_log_w("Invalid checksum: 0x%02x (calculated 0x%02x)", b, _checksum);
       return ParserResult::CS_ERROR;
     }
-    _step = ParserStep::STARTBYTE;
+    _packet._checksum = _checksum;
+    _packet._checksumValid = true;
     return ParserResult::COMPLETE;
   }
   return ParserResult::CONTINUE;
 }
 
+/*
+Parses a chunk of bytes and stops at the first packet boundary or error.
+The number of bytes used is stored in consumed, the remainder has to be
+passed again in a next call.
+*/
+ParserResult ParserVS2::parse(const uint8_t* data, std::size_t length, std::size_t* consumed) {
+  std::size_t i = 0;
+  ParserResult result = ParserResult::CONTINUE;
+  while (i < length && result == ParserResult::CONTINUE) {
+    if (_step == ParserStep::PAYLOAD) {
+      std::size_t toCopy = (length - i < _payloadLength) ? length - i : _payloadLength;
+      std::memcpy(&_packet[6 + _packet.dataLength() - _payloadLength], &data[i], toCopy);
+      for (std::size_t j = 0; j < toCopy; ++j) {
+        _checksum += data[i + j];
+      }
+      i += toCopy;
+      _payloadLength -= toCopy;
+      if (_payloadLength == 0) {
+        _step = ParserStep::CHECKSUM;
+      }
+      continue;
+    }
+    result = parse(data[i++]);
+  }
+  if (consumed) *consumed = i;
+  return result;
+}
+
 const VitoWiFi::PacketVS2& ParserVS2::packet() const {
   return _packet;
 }
 
+/*
+Called on an invalid header: the rejected start byte may have been a data
+byte. Rescan the header bytes received after it for the next start byte
+instead of dropping them. The rejected start byte counts as skipped, the
+resync is counted once the next packet starts.
+*/
+ParserResult ParserVS2::_resync() {
+  ++_skipped;
+  uint8_t window[sizeof(_window)];
+  std::size_t windowLength = _windowLength;
+  std::memcpy(window, _window, windowLength);
+  _step = ParserStep::STARTBYTE;
+  _windowLength = 0;
+  for (std::size_t i = 0; i < windowLength; ++i) {
+    parse(window[i]);
+  }
+  return ParserResult::ERROR;
+}
+
+// true when the parser is waiting for a packet start
+bool ParserVS2::isIdle() const {
+  return _step == ParserStep::STARTBYTE;
+}
+
+void ParserVS2::reset() {
+  _step = ParserStep::STARTBYTE;
+  _payloadLength = 0;
+  _checksum = 0;
+  _windowLength = 0;
+  _skipped = 0;
+}
+
+// number of times bytes were dropped to find a packet start, not cleared by reset()
+uint32_t ParserVS2::resyncs() const {
+  return _resyncs;
+}
+
 }  // end namespace VitoWiFiInternals
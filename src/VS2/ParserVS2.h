@@ -22,11 +22,14 @@ class ParserVS2 {
  public:
   ParserVS2();
   ParserResult parse(const uint8_t b);
+  ParserResult parse(const uint8_t* data, std::size_t length, std::size_t* consumed);
   const VitoWiFi::PacketVS2& packet() const;
+  bool isIdle() const;
   void reset();
+  uint32_t resyncs() const;
 
  private:
-  VitoWiFi::PacketVS2 _packet;
+  EnginePacketVS2 _packet;
   enum class ParserStep {
     STARTBYTE,
     PACKETLENGTH,
@@ -39,6 +42,13 @@ class ParserVS2 {
     CHECKSUM
   }_step;
   uint8_t _payloadLength;
+  uint8_t _checksum;
+  uint8_t _window[6];  // header bytes after the start byte
+  std::size_t _windowLength;
+  std::size_t _skipped;
+  uint32_t _resyncs;
+
+  ParserResult _resync();
 };
 
 }  // end namespace VitoWiFiInternals
@@ -19,10 +19,26 @@ VS2::VS2(HardwareSerial* interface)
 , _bytesTransferred(0)
 , _interface(nullptr)
 , _parser()
+, _rxBuffer()
+, _rxLength(0)
+, _rxPosition(0)
 , _currentDatapoint(Datapoint(nullptr, 0, 0, noconv))
 , _currentPacket()
+, _queue()
+, _inFlight()
+, _inFlightCount(0)
+, _messageId(0)
+, _runToCompletion(false)
+, _maxRetries(2)
+, _retries(0)
+, _reportedRetries(0)
 , _onResponseCallback(nullptr)
-, _onErrorCallback(nullptr) {
+, _onErrorCallback(nullptr)
+, _metrics()
+, _stateSince(_currentMillis)
+, _latencyRecorder(nullptr)
+, _times()
+, _responseStart(0) {
   assert(interface != nullptr);
   _interface = new(std::nothrow) VitoWiFiInternals::HardwareSerialInterface(interface);
   if (!_interface) {
@@ -40,10 +56,26 @@ VS2::VS2(SoftwareSerial* interface)
 , _bytesTransferred(0)
 , _interface(nullptr)
 , _parser()
+, _rxBuffer()
+, _rxLength(0)
+, _rxPosition(0)
 , _currentDatapoint(Datapoint(nullptr, 0, 0, noconv))
 , _currentPacket()
+, _queue()
+, _inFlight()
+, _inFlightCount(0)
+, _messageId(0)
+, _runToCompletion(false)
+, _maxRetries(2)
+, _retries(0)
+, _reportedRetries(0)
 , _onResponseCallback(nullptr)
-, _onErrorCallback(nullptr) {
+, _onErrorCallback(nullptr)
+, _metrics()
+, _stateSince(_currentMillis)
+, _latencyRecorder(nullptr)
+, _times()
+, _responseStart(0) {
   assert(interface != nullptr);
   _interface = new(std::nothrow) VitoWiFiInternals::SoftwareSerialInterface(interface);
   if (!_interface) {
@@ -62,10 +94,26 @@ VS2::VS2(const char* interface)
 , _bytesTransferred(0)
 , _interface(nullptr)
 , _parser()
+, _rxBuffer()
+, _rxLength(0)
+, _rxPosition(0)
 , _currentDatapoint(Datapoint(nullptr, 0, 0, noconv))
 , _currentPacket()
+, _queue()
+, _inFlight()
+, _inFlightCount(0)
+, _messageId(0)
+, _runToCompletion(false)
+, _maxRetries(2)
+, _retries(0)
+, _reportedRetries(0)
 , _onResponseCallback(nullptr)
-, _onErrorCallback(nullptr) {
+, _onErrorCallback(nullptr)
+, _metrics()
+, _stateSince(_currentMillis)
+, _latencyRecorder(nullptr)
+, _times()
+, _responseStart(0) {
   assert(interface != nullptr);
   _interface = new(std::nothrow) VitoWiFiInternals::LinuxSerialInterface(interface);
   if (!_interface) {
@@ -86,66 +134,176 @@ void VS2::onError(OnErrorCallback callback) {
   _onErrorCallback = callback;
 }
 
-bool VS2::read(const Datapoint& datapoint) {
-  if (_currentDatapoint) {
+bool VS2::read(const Datapoint& datapoint, Priority priority) {
+  if (datapoint.length() == 0) {
+    vw_log_i("reading not possible, length error");
     return false;
   }
-  if (_currentPacket.createPacket(PacketType::REQUEST,
-                                  FunctionCode::READ,
-                                  0,
-                                  datapoint.address(),
-                                  datapoint.length())) {
-    _currentDatapoint = datapoint;
-    _requestTime = _currentMillis;
-    vw_log_i("reading packet OK");
-    return true;
+  VitoWiFiInternals::Request* request = _queue.acquire(priority);
+  if (!request) {
+    vw_log_i("reading not possible, queue full");
+    return false;
   }
-  vw_log_i("reading not possible, packet creation error");
-  return false;
+  request->datapoint = datapoint;
+  request->functionCode = FunctionCode::READ;
+  vw_log_i("reading packet OK");
+  return true;
 }
 
-bool VS2::write(const Datapoint& datapoint, const VariantValue& value) {
-  if (_currentDatapoint) {
-    return false;
+bool VS2::write(const Datapoint& datapoint, const VariantValue& value, Priority priority) {
+  // encode straight into the queue slot
+  VitoWiFiInternals::Request* request = _acquireWrite(datapoint, datapoint.length(), priority);
+  if (!request) return false;
+  datapoint.encode(request->data, datapoint.length(), value);
+  return true;
+}
+
+bool VS2::write(const Datapoint& datapoint, const uint8_t* data, uint8_t length, Priority priority) {
+  VitoWiFiInternals::Request* request = _acquireWrite(datapoint, length, priority);
+  if (!request) return false;
+  std::memcpy(request->data, data, length);
+  return true;
+}
+
+bool VS2::begin() {
+  _currentMillis = vw_millis();
+  _setState(State::RESET);
+  return _interface->begin();
+}
+
+void VS2::loop() {
+  _currentMillis = vw_millis();
+  if (_runToCompletion) {
+    // keep advancing as long as the state changes, bounded to guard against livelock
+    State previousState;
+    uint8_t steps = 0;
+    do {
+      previousState = _state;
+      _step();
+    } while (_state != previousState && ++steps < 2 * static_cast<uint8_t>(State::UNDEFINED));
+  } else {
+    _step();
+  }
+  if (_currentDatapoint && _currentMillis - _requestTime > 4000UL) {
+    _setState(State::RESET);
+    _reportedRetries = _retries;
+    VitoWiFiInternals::recordLatency(_latencyRecorder, _currentDatapoint.address(), _times, _currentMillis, OptolinkResult::TIMEOUT);
+    _tryOnError(OptolinkResult::TIMEOUT, _currentDatapoint);
+    _currentDatapoint = Datapoint(nullptr, 0, 0, noconv);
+  }
+  if (_inFlightCount > 0 && _currentMillis - _inFlight[0].requestTime > 4000UL) {
+    _setState(State::RESET);
+    _failInFlight(OptolinkResult::TIMEOUT);
   }
-  uint8_t* payload = reinterpret_cast<uint8_t*>(malloc(datapoint.length()));
-  if (!payload) return false;
-  datapoint.encode(payload, datapoint.length(), value);
-  bool result = write(datapoint, payload, datapoint.length());
-  free(payload);
-  return result;
 }
 
-bool VS2::write(const Datapoint& datapoint, const uint8_t* data, uint8_t length) {
+void VS2::setRunToCompletion(bool enable) {
+  _runToCompletion = enable;
+}
+
+void VS2::setMaxRetries(uint8_t maxRetries) {
+  _maxRetries = maxRetries;
+}
+
+uint8_t VS2::retries() const {
+  return _reportedRetries;
+}
+
+void VS2::end() {
+  _interface->end();
+  _setState(State::UNDEFINED);
   if (_currentDatapoint) {
-    return false;
+    Datapoint datapoint = _currentDatapoint;
+    _currentDatapoint = Datapoint(nullptr, 0, 0, noconv);
+    VitoWiFiInternals::recordLatency(_latencyRecorder, datapoint.address(), _times, _currentMillis, OptolinkResult::CANCELLED);
+    _tryOnError(OptolinkResult::CANCELLED, datapoint);
   }
-  if (length != datapoint.length()) {
-    vw_log_i("writing not possible, length error");
-    return false;
+  _failInFlight(OptolinkResult::CANCELLED);
+  // callers of dropped requests still get an answer, requests queued from these callbacks stay queued
+  for (std::size_t n = _queue.size(); n > 0; --n) {
+    VitoWiFiInternals::Request& request = _queue.front();
+    Datapoint datapoint = request.datapoint;
+    uint8_t superseded = request.superseded;
+    _queue.drop();
+    for (uint8_t i = 0; i < superseded; ++i) {
+      _tryOnError(OptolinkResult::SUPERSEDED, datapoint);
+    }
+    _tryOnError(OptolinkResult::CANCELLED, datapoint);
   }
-  if (_currentPacket.createPacket(PacketType::REQUEST,
-                                  FunctionCode::WRITE,
-                                  0,
-                                  datapoint.address(),
-                                  datapoint.length(),
-                                  data)) {
-    _currentDatapoint = datapoint;
-    _requestTime = _currentMillis;
-    vw_log_i("writing packet OK");
+}
+
+int VS2::getState() const {
+  return static_cast<std::underlying_type<State>::type>(_state);
+}
+
+bool VS2::isBusy() const {
+  if (_currentDatapoint || _inFlightCount > 0 || !_queue.empty()) {
     return true;
   }
-  vw_log_i("writing not possible, packet creation error");
   return false;
 }
 
-bool VS2::begin() {
-  _setState(State::RESET);
-  return _interface->begin();
+const QueueStats& VS2::queueStats(Priority priority) const {
+  return _queue.stats(priority);
 }
 
-void VS2::loop() {
-  _currentMillis = vw_millis();
+// a copy of the counters, time in the current state is included up to now
+LinkMetrics VS2::metrics() const {
+  LinkMetrics snapshot = _metrics;
+  snapshot.stateTime[static_cast<std::size_t>(_state)] += vw_millis() - _stateSince;
+  snapshot.resyncs = _parser.resyncs();
+  return snapshot;
+}
+
+void VS2::setLatencyRecorder(LatencyRecorder* recorder) {
+  _latencyRecorder = recorder;
+}
+
+int VS2::fd() const {
+  return _interface->fd();
+}
+
+// 0 when loop() can make progress right away, UINT32_MAX when only incoming data can
+uint32_t VS2::nextTimeout() const {
+  uint32_t now = vw_millis();
+  uint32_t timeout = UINT32_MAX;
+  switch (_state) {
+  case State::RESET_ACK:
+  case State::INIT_ACK:
+    timeout = VitoWiFiInternals::timeLeft(now, _lastMillis, 3000UL);
+    break;
+  case State::IDLE:
+    if (_currentDatapoint || _inFlightCount > 0) return 0;
+    timeout = VitoWiFiInternals::timeLeft(now, _lastMillis, 3000UL);  // keep-alive
+    break;
+  case State::SEND_ACK:
+    break;
+  case State::RECEIVE:
+    if (_parser.isIdle() && _currentDatapoint && _inFlightCount < MAX_IN_FLIGHT) return 0;
+    break;
+  case State::UNDEFINED:
+    return UINT32_MAX;
+  default:
+    return 0;  // sending
+  }
+  // received bytes that are buffered don't wake up the caller
+  if (_rxPosition < _rxLength || _interface->pending() > 0) return 0;
+  if (!_currentDatapoint && _inFlightCount < MAX_IN_FLIGHT && !_queue.empty()) return 0;
+  if (_currentDatapoint) {
+    uint32_t left = VitoWiFiInternals::timeLeft(now, _requestTime, 4000UL);
+    if (left < timeout) timeout = left;
+  }
+  if (_inFlightCount > 0) {
+    uint32_t left = VitoWiFiInternals::timeLeft(now, _inFlight[0].requestTime, 4000UL);
+    if (left < timeout) timeout = left;
+  }
+  return timeout;
+}
+
+void VS2::_step() {
+  if (!_currentDatapoint && _inFlightCount < MAX_IN_FLIGHT) {
+    _nextRequest();
+  }
   switch (_state) {
   case State::RESET:
     _reset();
@@ -180,50 +338,103 @@ void VS2::loop() {
   case State::RECEIVE_ACK:
     _receiveAck();
     break;
+  case State::RETRANSMIT:
+    _retransmit();
+    break;
   case State::UNDEFINED:
     // begin() not yet called
     break;
   }
-  if (_currentDatapoint && _currentMillis - _requestTime > 4000UL) {
-    _setState(State::RESET);
-    _tryOnError(OptolinkResult::TIMEOUT);
-  }
 }
 
-void VS2::end() {
-  _interface->end();
-  _setState(State::UNDEFINED);
-  _currentDatapoint = Datapoint(nullptr, 0, 0, noconv);
+void VS2::_setState(State state) {
+  static_assert(static_cast<std::size_t>(State::UNDEFINED) < MAX_LINK_STATES, "LinkMetrics can't hold all states");
+  vw_log_i("state %i --> %i", static_cast<std::underlying_type<State>::type>(_state), static_cast<std::underlying_type<State>::type>(state));
+  _metrics.stateTime[static_cast<std::size_t>(_state)] += _currentMillis - _stateSince;
+  _stateSince = _currentMillis;
+  _state = state;
 }
 
-int VS2::getState() const {
-  return static_cast<std::underlying_type<State>::type>(_state);
+VitoWiFiInternals::Request* VS2::_acquireWrite(const Datapoint& datapoint, uint8_t length, Priority priority) {
+  if (length == 0 || length != datapoint.length() || length > QUEUE_PAYLOAD_LENGTH) {
+    vw_log_i("writing not possible, length error");
+    return nullptr;
+  }
+  VitoWiFiInternals::Request* request = _queue.acquireWrite(datapoint, priority);
+  if (!request) {
+    vw_log_i("writing not possible, queue full");
+    return nullptr;
+  }
+  request->datapoint = datapoint;
+  request->functionCode = FunctionCode::WRITE;
+  vw_log_i("writing packet OK");
+  return request;
 }
 
-bool VS2::isBusy() const {
-  if (_currentDatapoint) {
-    return true;
+std::size_t VS2::_write(const uint8_t* data, uint8_t length) {
+  std::size_t written = _interface->write(data, length);
+  _metrics.bytesSent += written;
+  return written;
+}
+
+// pop requests from the queue until one is turned into a packet
+bool VS2::_nextRequest() {
+  while (!_queue.empty()) {
+    VitoWiFiInternals::Request& request = _queue.front();
+    bool created = _currentPacket.createPacket(PacketType::REQUEST,
+                                               request.functionCode,
+                                               _messageId,
+                                               request.datapoint.address(),
+                                               request.datapoint.length(),
+                                               request.functionCode == FunctionCode::WRITE ? request.data : nullptr);
+    Datapoint datapoint = request.datapoint;
+    uint8_t superseded = request.superseded;
+    _times.set(VitoWiFiInternals::RequestTimes::ENQUEUED, request.enqueueTime);
+    _times.set(VitoWiFiInternals::RequestTimes::DISPATCHED, _currentMillis);
+    _queue.pop();
+    _reportedRetries = 0;
+    for (uint8_t i = 0; i < superseded; ++i) {
+      _tryOnError(OptolinkResult::SUPERSEDED, datapoint);
+    }
+    if (created) {
+      _currentDatapoint = datapoint;
+      _requestTime = _currentMillis;
+      _retries = 0;
+      _messageId = (_messageId + 1) & 0x07;
+      return true;
+    }
+    vw_log_i("packet creation error");
+    VitoWiFiInternals::recordLatency(_latencyRecorder, datapoint.address(), _times, _currentMillis, OptolinkResult::ERROR);
+    _tryOnError(OptolinkResult::ERROR, datapoint);
   }
   return false;
 }
 
-void VS2::_setState(State state) {
-  vw_log_i("state %i --> %i", static_cast<std::underlying_type<State>::type>(_state), static_cast<std::underlying_type<State>::type>(state));
-  _state = state;
+// true when there are received bytes to handle, reads the next chunk when all are handled
+bool VS2::_fillRx() {
+  if (_rxPosition == _rxLength) {
+    _rxLength = static_cast<uint8_t>(_interface->read(_rxBuffer, sizeof(_rxBuffer)));
+    _metrics.bytesReceived += _rxLength;
+    _rxPosition = 0;
+  }
+  return _rxPosition < _rxLength;
 }
 
 void VS2::_reset() {
-  while (_interface->available()) _interface->read();
-  if (_interface->write(&VitoWiFiInternals::ProtocolBytes.EOT, 1) == 1) {
+  while (_fillRx()) _rxPosition = _rxLength;
+  _parser.reset();  // drop a partial frame, the ACK of the next request would be parsed as its data
+  if (_write(&VitoWiFiInternals::ProtocolBytes.EOT, 1) == 1) {
+    ++_metrics.resets;
     _lastMillis = _currentMillis;
     _setState(State::RESET_ACK);
   }
 }
 
 void VS2::_resetAck() {
-  if (_interface->available()) {
-    uint8_t buff = _interface->read();
+  if (_fillRx()) {
+    uint8_t buff = _rxBuffer[_rxPosition++];
     if (buff == VitoWiFiInternals::ProtocolBytes.ENQ) {
+      ++_metrics.inits;
       _lastMillis = _currentMillis;
       _setState(State::INIT);
     }
@@ -235,8 +446,8 @@ void VS2::_resetAck() {
 }
 
 void VS2::_init() {
-  _bytesTransferred += _interface->write(&VitoWiFiInternals::ProtocolBytes.SYNC[_bytesTransferred],
-                                  sizeof(VitoWiFiInternals::ProtocolBytes.SYNC) - _bytesTransferred);
+  _bytesTransferred += _write(&VitoWiFiInternals::ProtocolBytes.SYNC[_bytesTransferred],
+                              sizeof(VitoWiFiInternals::ProtocolBytes.SYNC) - _bytesTransferred);
   if (_bytesTransferred == sizeof(VitoWiFiInternals::ProtocolBytes.SYNC)) {
     _bytesTransferred = 0;
     _lastMillis = _currentMillis;
@@ -245,8 +456,8 @@ void VS2::_init() {
 }
 
 void VS2::_initAck() {
-  if (_interface->available()) {
-    uint8_t buff = _interface->read();
+  if (_fillRx()) {
+    uint8_t buff = _rxBuffer[_rxPosition++];
     vw_log_i("rcv: 0x%02x", buff);
     if (buff == VitoWiFiInternals::ProtocolBytes.ACK) {
       _setState(State::IDLE);
@@ -259,93 +470,196 @@ void VS2::_initAck() {
 }
 
 void VS2::_idle() {
-  if (_currentDatapoint) {
+  if (_inFlightCount > 0 && !_inFlight[_inFlightCount - 1].acked) {
+    _setState(State::SEND_ACK);
+    return;
+  }
+  if (_currentDatapoint && _inFlightCount < MAX_IN_FLIGHT) {
     _setState(State::SENDSTART);
+  } else if (_inFlightCount > 0) {
+    _setState(State::RECEIVE);
+    return;
   }
   // send INIT every 3 seconds to keep communication alive
   if (_currentMillis - _lastMillis > 3000UL) {
+    ++_metrics.keepAlives;
     _setState(State::INIT);
   }
 }
 
 void VS2::_sendStart() {
-  if (_interface->write(&VitoWiFiInternals::ProtocolBytes.PACKETSTART, 1) == 1) {
+  if (_write(&VitoWiFiInternals::ProtocolBytes.PACKETSTART, 1) == 1) {
     _lastMillis = _currentMillis;
     _setState(State::SENDPACKET);
   }
 }
 
 void VS2::_sendPacket() {
-  _bytesTransferred += _interface->write(&_currentPacket[_bytesTransferred], _currentPacket.length() - _bytesTransferred);
-  if (_bytesTransferred == _currentPacket.length()) {
+  const PacketVS2& packet = _currentPacket;  // read only, keeps the checksum of createPacket()
+  _bytesTransferred += _write(&packet[_bytesTransferred], packet.length() - _bytesTransferred);
+  if (_bytesTransferred == packet.length()) {
     _bytesTransferred = 0;
     _lastMillis = _currentMillis;
     _setState(State::SEND_CRC);
   }
 }
 
+// once sent, the request is in flight until its response arrives
 void VS2::_sendCRC() {
   uint8_t crc = _currentPacket.checksum();
-  if (_interface->write(&crc, 1) == 1) {
+  if (_write(&crc, 1) == 1) {
     _lastMillis = _currentMillis;
+    InFlight& request = _inFlight[_inFlightCount++];
+    request.datapoint = _currentDatapoint;
+    request.functionCode = _currentPacket.functionCode();
+    request.id = _currentPacket.id();
+    request.requestTime = _requestTime;
+    request.retries = _retries;
+    request.acked = false;
+    _times.set(VitoWiFiInternals::RequestTimes::SENT, _currentMillis);
+    request.times = _times;
+    _currentDatapoint = Datapoint(nullptr, 0, 0, noconv);
     _setState(State::SEND_ACK);
   }
 }
 
+// requests are only sent while the controller is silent, the ACK comes first
 void VS2::_sendAck() {
-  if (_interface->available()) {
-    uint8_t buff = _interface->read();
-    vw_log_i("rcv: 0x%02x", buff);
-    if (buff == VitoWiFiInternals::ProtocolBytes.ACK) {  // transmit succesful, moving to next state
-      _setState(State::RECEIVE);
-    } else if (buff == VitoWiFiInternals::ProtocolBytes.NACK) {  // transmit negatively acknowledged, return to IDLE
-      _setState(State::IDLE);
-      _tryOnError(OptolinkResult::NACK);
-      return;
-    }
-  }
+  _receive();
 }
 
 void VS2::_receive() {
-  while (_interface->available()) {
+  bool framingError = false;
+  while (_fillRx()) {
     _lastMillis = _currentMillis;
-    VitoWiFiInternals::ParserResult result = _parser.parse(_interface->read());
+    // only look for the ACK, a stray start byte would make the parser take the ACK as packet length
+    if (_state == State::SEND_ACK) {
+      uint8_t buff = _rxBuffer[_rxPosition++];
+      if (buff == VitoWiFiInternals::ProtocolBytes.ACK) {  // transmit succesful, moving to next state
+        _inFlight[_inFlightCount - 1].acked = true;
+        _setState(State::RECEIVE);
+      } else if (buff == VitoWiFiInternals::ProtocolBytes.NACK) {  // transmit negatively acknowledged, return to IDLE
+        Datapoint datapoint = _inFlight[--_inFlightCount].datapoint;
+        _reportedRetries = _inFlight[_inFlightCount].retries;
+        VitoWiFiInternals::recordLatency(_latencyRecorder, datapoint.address(), _inFlight[_inFlightCount].times, _currentMillis, OptolinkResult::NACK);
+        _setState(State::IDLE);
+        _tryOnError(OptolinkResult::NACK, datapoint);
+        return;
+      } else {
+        vw_log_w("Dropping 0x%02x before ACK", buff);
+      }
+      continue;
+    }
+    std::size_t length = _rxLength - _rxPosition;
+    std::size_t consumed = 0;
+    bool waiting = _parser.isIdle();
+    VitoWiFiInternals::ParserResult result = _parser.parse(&_rxBuffer[_rxPosition], length, &consumed);
+    _rxPosition += consumed;
+    if (waiting && (!_parser.isIdle() || result == VitoWiFiInternals::ParserResult::COMPLETE)) {
+      _responseStart = _currentMillis;
+    }
     if (result == VitoWiFiInternals::ParserResult::COMPLETE) {
       _setState(State::RECEIVE_ACK);
       _tryOnResponse();
       return;
     } else if (result == VitoWiFiInternals::ParserResult::CS_ERROR) {
-      _setState(State::RESET);
-      _tryOnError(OptolinkResult::CRC);
-      return;
-    } else if (result == VitoWiFiInternals::ParserResult::ERROR) {
-      _setState(State::RESET);
-      _tryOnError(OptolinkResult::ERROR);
+      ++_metrics.checksumErrors;
+      _rejectResponse(OptolinkResult::CRC);
       return;
+    } else if (result == VitoWiFiInternals::ParserResult::ERROR && _state == State::RECEIVE && _inFlightCount > 0) {
+      // corrupted header: the parser rescanned it, the response can still follow in the remaining bytes
+      framingError = true;
     }
-    // else: continue
+  }
+  if (framingError && _parser.isIdle()) {
+    _rejectResponse(OptolinkResult::ERROR);
+    return;
+  }
+  // pipeline the next request when the controller is silent
+  if (_state == State::RECEIVE && _parser.isIdle() &&
+      _currentDatapoint && _inFlightCount < MAX_IN_FLIGHT) {
+    _setState(State::SENDSTART);
   }
 }
 
 void VS2::_receiveAck() {
-  if (_interface->write(&VitoWiFiInternals::ProtocolBytes.ACK, 1) == 1) {
+  if (_write(&VitoWiFiInternals::ProtocolBytes.ACK, 1) == 1) {
     _lastMillis = _currentMillis;
     _setState(State::IDLE);
+    _idle();  // start next queued request right away
+  }
+}
+
+// reject the corrupted response and send the same packet again
+void VS2::_retransmit() {
+  if (_write(&VitoWiFiInternals::ProtocolBytes.NACK, 1) == 1) {
+    _lastMillis = _currentMillis;
+    _currentDatapoint = _inFlight[0].datapoint;
+    _requestTime = _inFlight[0].requestTime;  // retries count towards the timeout
+    _retries = _inFlight[0].retries + 1;
+    _times = _inFlight[0].times;
+    _inFlightCount = 0;
+    _setState(State::SENDSTART);
+  }
+}
+
+// retransmit when possible, the request is still in _currentPacket when it is the only one sent
+void VS2::_rejectResponse(OptolinkResult result) {
+  if (_inFlightCount == 1 && !_currentDatapoint && _inFlight[0].retries < _maxRetries) {
+    vw_log_w("%s, retransmitting", result == OptolinkResult::CRC ? "CRC error" : "Framing error");
+    _setState(State::RETRANSMIT);
+    return;
   }
+  _setState(State::RESET);
+  _failInFlight(result);
 }
 
+// match the response to an in flight request by id, function code and address
+// unmatched responses are stale or unsolicited and are dropped
 void VS2::_tryOnResponse() {
-  if (_onResponseCallback) {
-    _onResponseCallback(_parser.packet(), _currentDatapoint);
+  const PacketVS2& response = _parser.packet();
+  for (uint8_t i = 0; i < _inFlightCount; ++i) {
+    if (_inFlight[i].id == response.id() &&
+        _inFlight[i].functionCode == response.functionCode() &&
+        _inFlight[i].datapoint.address() == response.address()) {
+      Datapoint datapoint = _inFlight[i].datapoint;
+      uint8_t retries = _inFlight[i].retries;
+      VitoWiFiInternals::RequestTimes times = _inFlight[i].times;
+      times.set(VitoWiFiInternals::RequestTimes::RESPONDED, _responseStart);
+      for (uint8_t j = i + 1; j < _inFlightCount; ++j) {
+        _inFlight[j - 1] = _inFlight[j];
+      }
+      _reportedRetries = retries;
+      --_inFlightCount;
+      ++_metrics.results[static_cast<std::size_t>(OptolinkResult::PACKET)];
+      VitoWiFiInternals::recordLatency(_latencyRecorder, datapoint.address(), times, _currentMillis, OptolinkResult::PACKET);
+      if (_onResponseCallback) {
+        _onResponseCallback(response, datapoint);
+      }
+      return;
+    }
   }
-  _currentDatapoint = Datapoint(nullptr, 0, 0, noconv);
+  vw_log_w("Dropping unexpected response: id %u, address 0x%04x", response.id(), response.address());
 }
 
-void VS2::_tryOnError(OptolinkResult result) {
+void VS2::_tryOnError(OptolinkResult result, const Datapoint& datapoint) {
+  ++_metrics.results[static_cast<std::size_t>(result)];
   if (_onErrorCallback) {
-    _onErrorCallback(result, _currentDatapoint);
+    _onErrorCallback(result, datapoint);
+  }
+}
+
+void VS2::_failInFlight(OptolinkResult result) {
+  while (_inFlightCount > 0) {
+    Datapoint datapoint = _inFlight[0].datapoint;
+    _reportedRetries = _inFlight[0].retries;
+    VitoWiFiInternals::recordLatency(_latencyRecorder, datapoint.address(), _inFlight[0].times, _currentMillis, result);
+    for (uint8_t j = 1; j < _inFlightCount; ++j) {
+      _inFlight[j - 1] = _inFlight[j];
+    }
+    --_inFlightCount;
+    _tryOnError(result, datapoint);
   }
-  _currentDatapoint = Datapoint(nullptr, 0, 0, noconv);
 }
 
 }  // end namespace VitoWiFi
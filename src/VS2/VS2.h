@@ -13,6 +13,9 @@ the LICENSE file.
 #include "Logging.h"
 #include "../Constants.h"
 #include "../Helpers.h"
+#include "../RequestQueue.h"
+#include "../LinkMetrics.h"
+#include "../LatencyHistograms.h"
 #include "ParserVS2.h"
 #include "../Datapoint/Datapoint.h"
 #if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_ESP32)
@@ -49,10 +52,26 @@ class VS2 {
   , _bytesTransferred(0)
   , _interface(nullptr)
   , _parser()
+  , _rxBuffer()
+  , _rxLength(0)
+  , _rxPosition(0)
   , _currentDatapoint(Datapoint(nullptr, 0, 0, noconv))
   , _currentPacket()
+  , _queue()
+  , _inFlight()
+  , _inFlightCount(0)
+  , _messageId(0)
+  , _runToCompletion(false)
+  , _maxRetries(2)
+  , _retries(0)
+  , _reportedRetries(0)
   , _onResponseCallback(nullptr)
-  , _onErrorCallback(nullptr) {
+  , _onErrorCallback(nullptr)
+  , _metrics()
+  , _stateSince(_currentMillis)
+  , _latencyRecorder(nullptr)
+  , _times()
+  , _responseStart(0) {
     assert(interface != nullptr);
     _interface = new(std::nothrow) VitoWiFiInternals::GenericInterface<C>(interface);
     if (!_interface) {
@@ -67,16 +86,32 @@ class VS2 {
   void onResponse(OnResponseCallback callback);
   void onError(OnErrorCallback callback);
 
-  bool read(const Datapoint& datapoint);
-  bool write(const Datapoint& datapoint, const VariantValue& value);
-  bool write(const Datapoint& datapoint, const uint8_t* data, uint8_t length);
+  bool read(const Datapoint& datapoint, Priority priority = Priority::INTERACTIVE_READ);
+  bool write(const Datapoint& datapoint, const VariantValue& value, Priority priority = Priority::INTERACTIVE_WRITE);
+  bool write(const Datapoint& datapoint, const uint8_t* data, uint8_t length, Priority priority = Priority::INTERACTIVE_WRITE);
 
   bool begin();
   void loop();
   void end();
 
+  // when enabled, loop() advances through as many states as possible instead of one state per call
+  void setRunToCompletion(bool enable);
+
+  // number of retransmissions after a CRC error before the connection is reset
+  void setMaxRetries(uint8_t maxRetries);
+  // retransmissions needed for the request in the current onResponse or onError callback
+  uint8_t retries() const;
+
   int getState() const;
   bool isBusy() const;
+  const QueueStats& queueStats(Priority priority) const;
+  LinkMetrics metrics() const;
+  // recorder receives the latencies of every finished request, nullptr to stop
+  void setLatencyRecorder(LatencyRecorder* recorder);
+
+  // for event loops: wait until fd() is readable or nextTimeout() milliseconds have passed, then call loop()
+  int fd() const;
+  uint32_t nextTimeout() const;
 
  private:
   enum class State {
@@ -91,6 +126,7 @@ class VS2 {
     SEND_ACK,
     RECEIVE,
     RECEIVE_ACK,
+    RETRANSMIT,
     UNDEFINED
   } _state;
   uint32_t _currentMillis;
@@ -99,12 +135,50 @@ class VS2 {
   uint8_t _bytesTransferred;
   VitoWiFiInternals::SerialInterface* _interface;
   VitoWiFiInternals::ParserVS2 _parser;
+  // received bytes not yet handled, filled in chunks from the interface
+  uint8_t _rxBuffer[16];
+  uint8_t _rxLength;
+  uint8_t _rxPosition;
   Datapoint _currentDatapoint;
-  PacketVS2 _currentPacket;
+  VitoWiFiInternals::EnginePacketVS2 _currentPacket;
+  VitoWiFiInternals::RequestQueue _queue;
+  struct InFlight {
+    InFlight()
+    : datapoint(nullptr, 0, 0, noconv)
+    , functionCode(FunctionCode::READ)
+    , id(0)
+    , requestTime(0)
+    , retries(0)
+    , acked(false)
+    , times() {}
+    Datapoint datapoint;
+    FunctionCode functionCode;
+    uint8_t id;
+    uint32_t requestTime;
+    uint8_t retries;
+    bool acked;
+    VitoWiFiInternals::RequestTimes times;
+  } _inFlight[MAX_IN_FLIGHT];
+  uint8_t _inFlightCount;
+  uint8_t _messageId;
+  bool _runToCompletion;
+  uint8_t _maxRetries;
+  uint8_t _retries;  // of _currentPacket
+  uint8_t _reportedRetries;
   OnResponseCallback _onResponseCallback;
   OnErrorCallback _onErrorCallback;
+  LinkMetrics _metrics;
+  uint32_t _stateSince;
+  LatencyRecorder* _latencyRecorder;
+  VitoWiFiInternals::RequestTimes _times;  // of _currentDatapoint
+  uint32_t _responseStart;  // first byte of the response being parsed
 
   inline void _setState(State state);
+  void _step();
+  VitoWiFiInternals::Request* _acquireWrite(const Datapoint& datapoint, uint8_t length, Priority priority);
+  bool _nextRequest();
+  std::size_t _write(const uint8_t* data, uint8_t length);
+  bool _fillRx();
 
   void _reset();
   void _resetAck();
@@ -117,9 +191,12 @@ class VS2 {
   void _sendAck();
   void _receive();
   void _receiveAck();
+  void _retransmit();
+  void _rejectResponse(OptolinkResult result);
 
   void _tryOnResponse();
-  void _tryOnError(OptolinkResult result);
+  void _tryOnError(OptolinkResult result, const Datapoint& datapoint);
+  void _failInFlight(OptolinkResult result);
 };
 
 }  // end namespace VitoWiFi
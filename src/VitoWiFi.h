@@ -11,24 +11,26 @@ the LICENSE file.
 #include "VS2/VS2.h"
 #include "VS1/VS1.h"
 #include "GWG/GWG.h"
+#include "Listener.h"
+#include "ReadPlanner.h"
+#include "Poller.h"
+#include "Scheduler.h"
+#include "ResponseCache.h"
+#include "ChangeFilter.h"
+#include "LinkManager.h"
 
 namespace VitoWiFi {
 
 template<class PROTOCOLVERSION>
-class VitoWiFi {
+class VitoWiFi : public Source<PROTOCOLVERSION> {
  public:
   template <class IFACE>
   explicit VitoWiFi(IFACE* interface)
   : _optolink(interface) {
-    // empty
-  }
-
-  void onResponse(typename PROTOCOLVERSION::OnResponseCallback callback) {
-    _optolink.onResponse(callback);
-  }
-
-  void onError(typename PROTOCOLVERSION::OnErrorCallback callback) {
-    _optolink.onError(callback);
+    _optolink.onResponse(ResponseHandler{this});
+    _optolink.onError([this](OptolinkResult error, const Datapoint& request) {
+      this->_emitError(error, request);
+    });
   }
 
   bool begin() {
@@ -43,22 +45,37 @@ class VitoWiFi {
     _optolink.loop();
   }
 
-  bool read(Datapoint datapoint) {
-    return _optolink.read(datapoint);
+  // VS2 only
+  void setRunToCompletion(bool enable) {
+    _optolink.setRunToCompletion(enable);
+  }
+
+  // VS2 only
+  void setMaxRetries(uint8_t maxRetries) {
+    _optolink.setMaxRetries(maxRetries);
+  }
+
+  // VS2 only
+  uint8_t retries() const {
+    return _optolink.retries();
+  }
+
+  bool read(Datapoint datapoint, Priority priority = Priority::INTERACTIVE_READ) {
+    return _optolink.read(datapoint, priority);
   }
 
   template <typename T>
-  bool write(Datapoint datapoint, T value) {
+  bool write(Datapoint datapoint, T value, Priority priority = Priority::INTERACTIVE_WRITE) {
     VariantValue v(value);
-    return _optolink.write(datapoint, v);
+    return _optolink.write(datapoint, v, priority);
   }
 
-  bool write(Datapoint datapoint, const uint8_t* data, uint8_t length) {
-    return _optolink.write(datapoint, data, length);
+  bool write(Datapoint datapoint, const uint8_t* data, uint8_t length, Priority priority = Priority::INTERACTIVE_WRITE) {
+    return _optolink.write(datapoint, data, length, priority);
   }
 
-  bool write(Datapoint datapoint, const uint8_t* data) {
-    return _optolink.write(datapoint, data, datapoint.length());
+  bool write(Datapoint datapoint, const uint8_t* data, Priority priority = Priority::INTERACTIVE_WRITE) {
+    return _optolink.write(datapoint, data, datapoint.length(), priority);
   }
 
   int getState() {
@@ -69,7 +86,38 @@ class VitoWiFi {
     return _optolink.isBusy();
   }
 
+  const QueueStats& queueStats(Priority priority) const {
+    return _optolink.queueStats(priority);
+  }
+
+  LinkMetrics metrics() const {
+    return _optolink.metrics();
+  }
+
+  void setLatencyRecorder(LatencyRecorder* recorder) {
+    _optolink.setLatencyRecorder(recorder);
+  }
+
+  int fd() const {
+    return _optolink.fd();
+  }
+
+  uint32_t nextTimeout() const {
+    return _optolink.nextTimeout();
+  }
+
  private:
+  // dispatches to the overload matching the callback signature of the protocol
+  struct ResponseHandler {
+    VitoWiFi* vitoWiFi;
+    void operator()(const PacketVS2& response, const Datapoint& request) const {
+      vitoWiFi->_emitResponse(response, request);
+    }
+    void operator()(const uint8_t* data, uint8_t length, const Datapoint& request) const {
+      vitoWiFi->_emitResponse(data, length, request);
+    }
+  };
+
   PROTOCOLVERSION _optolink;
 };
 
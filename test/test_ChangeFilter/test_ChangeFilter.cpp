@@ -0,0 +1,170 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#include <unity.h>
+
+#include <VitoWiFi.h>
+
+using VitoWiFi::Datapoint;
+using VitoWiFi::Priority;
+
+class MockProtocol;
+MockProtocol* protocol = nullptr;
+
+// records the requests and lets the test trigger the callbacks
+class MockProtocol {
+ public:
+  typedef VitoWiFi::VS1::OnResponseCallback OnResponseCallback;
+  typedef VitoWiFi::VS1::OnErrorCallback OnErrorCallback;
+
+  explicit MockProtocol(void* interface)
+  : busy(false)
+  , reads(0)
+  , lastRead(nullptr, 0, 0, VitoWiFi::noconv)
+  , onResponseCallback(nullptr)
+  , onErrorCallback(nullptr) {
+    (void) interface;
+    protocol = this;
+  }
+  void onResponse(OnResponseCallback callback) {
+    onResponseCallback = callback;
+  }
+  void onError(OnErrorCallback callback) {
+    onErrorCallback = callback;
+  }
+  bool read(const Datapoint& datapoint, Priority priority) {
+    (void) priority;
+    ++reads;
+    lastRead = datapoint;
+    return true;
+  }
+  bool isBusy() const {
+    return busy;
+  }
+  void respond(uint8_t low, uint8_t high) {
+    const uint8_t data[2] = {low, high};
+    onResponseCallback(data, lastRead.length(), lastRead);
+  }
+
+  bool busy;
+  std::size_t reads;
+  Datapoint lastRead;
+  OnResponseCallback onResponseCallback;
+  OnErrorCallback onErrorCallback;
+};
+
+Datapoint outside("outsidetemp", 0x5525, 2, VitoWiFi::div10);
+Datapoint pump("pump", 0x7660, 2, VitoWiFi::noconv);
+Datapoint boiler("boilertemp", 0x0810, 2, VitoWiFi::div10);
+
+VitoWiFi::VitoWiFi<MockProtocol>* vitoWiFi = nullptr;
+VitoWiFi::ChangeFilter<MockProtocol, 2>* filter = nullptr;
+std::size_t responses = 0;
+
+void setUp() {
+  vitoWiFi = new VitoWiFi::VitoWiFi<MockProtocol>(static_cast<void*>(nullptr));
+  filter = new VitoWiFi::ChangeFilter<MockProtocol, 2>(vitoWiFi);
+  responses = 0;
+  filter->onResponse([](const uint8_t* data, uint8_t length, const Datapoint& request) {
+    (void) data;
+    (void) length;
+    (void) request;
+    ++responses;
+  });
+}
+
+void tearDown() {
+  delete filter;
+  delete vitoWiFi;
+}
+
+void test_exact() {
+  TEST_ASSERT_TRUE(filter->add(pump));
+  vitoWiFi->read(pump);
+  protocol->respond(0x01, 0x00);
+  protocol->respond(0x01, 0x00);
+  TEST_ASSERT_EQUAL_UINT(1, responses);
+  protocol->respond(0x00, 0x00);
+  TEST_ASSERT_EQUAL_UINT(2, responses);
+  TEST_ASSERT_EQUAL_UINT32(1, filter->suppressed());
+
+  filter->reset();
+  protocol->respond(0x00, 0x00);
+  TEST_ASSERT_EQUAL_UINT(3, responses);
+}
+
+void test_deadband() {
+  TEST_ASSERT_FALSE(filter->add(pump, 1.0f));
+  TEST_ASSERT_TRUE(filter->add(outside, 0.5f));
+  vitoWiFi->read(outside);
+  protocol->respond(0xC8, 0x00);  // 20.0
+  protocol->respond(0xCB, 0x00);  // 20.3
+  protocol->respond(0xC5, 0x00);  // 19.7
+  TEST_ASSERT_EQUAL_UINT(1, responses);
+  protocol->respond(0xCD, 0x00);  // 20.5
+  TEST_ASSERT_EQUAL_UINT(2, responses);
+  TEST_ASSERT_EQUAL_UINT32(2, filter->suppressed());
+
+  // not registered
+  vitoWiFi->read(boiler);
+  protocol->respond(0xCD, 0x00);
+  protocol->respond(0xCD, 0x00);
+  TEST_ASSERT_EQUAL_UINT(4, responses);
+}
+
+void test_stacked() {
+  VitoWiFi::ResponseCache<MockProtocol, 2> cache(vitoWiFi);
+  VitoWiFi::ChangeFilter<MockProtocol, 2> cacheFilter(&cache);
+  std::size_t filtered = 0;
+  std::size_t raw = 0;
+  cacheFilter.onResponse([&filtered](const uint8_t* data, uint8_t length, const Datapoint& request) {
+    (void) data;
+    (void) length;
+    (void) request;
+    ++filtered;
+  });
+  vitoWiFi->onResponse([&raw](const uint8_t* data, uint8_t length, const Datapoint& request) {
+    (void) data;
+    (void) length;
+    (void) request;
+    ++raw;
+  });
+  TEST_ASSERT_TRUE(filter->add(pump));
+  TEST_ASSERT_TRUE(cacheFilter.add(pump));
+  TEST_ASSERT_TRUE(cache.add(pump, 60000));
+
+  TEST_ASSERT_TRUE(cache.read(pump));
+  protocol->respond(0x01, 0x00);
+  TEST_ASSERT_EQUAL_UINT(1, responses);
+  TEST_ASSERT_EQUAL_UINT(1, filtered);
+  TEST_ASSERT_EQUAL_UINT(1, raw);
+
+  // the cached answer passes the filter stacked on the cache
+  TEST_ASSERT_TRUE(cache.read(pump));
+  cache.loop();
+  TEST_ASSERT_EQUAL_UINT(1, protocol->reads);
+  TEST_ASSERT_EQUAL_UINT32(1, cache.hits());
+  TEST_ASSERT_EQUAL_UINT(1, filtered);
+  TEST_ASSERT_EQUAL_UINT32(1, cacheFilter.suppressed());
+  TEST_ASSERT_EQUAL_UINT(1, raw);
+
+  vitoWiFi->read(pump);
+  protocol->respond(0x02, 0x00);
+  TEST_ASSERT_EQUAL_UINT(2, responses);
+  TEST_ASSERT_EQUAL_UINT(2, filtered);
+  TEST_ASSERT_EQUAL_UINT(2, raw);
+  vitoWiFi->onResponse(nullptr);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_exact);
+  RUN_TEST(test_deadband);
+  RUN_TEST(test_stacked);
+  return UNITY_END();
+}
@@ -0,0 +1,109 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#include <unity.h>
+
+#include <chrono>
+#include <cstring>
+
+#include <VitoWiFi.h>
+
+// the emulator isn't part of the library, it is built with this test
+#include "../../tools/emulator/Emulator.cpp"
+
+using VitoWiFi::Datapoint;
+using VitoWiFi::OptolinkResult;
+
+std::size_t responses = 0;
+std::size_t errors = 0;
+uint8_t lastLength = 0;
+uint8_t lastData[4] = {0};
+
+void setUp() {
+  responses = 0;
+  errors = 0;
+  lastLength = 0;
+  std::memset(lastData, 0, sizeof(lastData));
+}
+
+void tearDown() {}
+
+uint64_t now() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// runs emulator and client until the number of requests has completed or 5 seconds have passed
+template <class PROTOCOLVERSION>
+void run(VitoWiFiEmulator::Emulator* emulator, VitoWiFi::VitoWiFi<PROTOCOLVERSION>* vitoWiFi, std::size_t completed) {
+  uint64_t deadline = now() + 5000;
+  while (responses + errors < completed && now() < deadline) {
+    emulator->loop(1);
+    vitoWiFi->loop();
+  }
+}
+
+// write, check the emulator's memory and read the value back
+template <class PROTOCOLVERSION>
+void roundTrip(VitoWiFiEmulator::Protocol protocol) {
+  VitoWiFiEmulator::Config config;
+  config.protocol = protocol;
+  config.enqInterval = 20;
+  config.responseDelay = 0;
+  config.byteTiming = false;
+  VitoWiFiEmulator::Emulator emulator(config);
+  TEST_ASSERT_TRUE(emulator.begin());
+
+  VitoWiFi::VitoWiFi<PROTOCOLVERSION> vitoWiFi(emulator.devicePath());
+  vitoWiFi.onResponse([](const uint8_t* data, uint8_t length, const Datapoint& request) {
+    (void) request;
+    ++responses;
+    lastLength = length;
+    std::memcpy(lastData, data, length < sizeof(lastData) ? length : sizeof(lastData));
+  });
+  vitoWiFi.onError([](OptolinkResult error, const Datapoint& request) {
+    (void) error;
+    (void) request;
+    ++errors;
+  });
+  TEST_ASSERT_TRUE(vitoWiFi.begin());
+
+  Datapoint dp("dp", 0x0055, 2, VitoWiFi::div10);
+  const uint8_t value[] = {0xD7, 0x00};
+  TEST_ASSERT_TRUE(vitoWiFi.write(dp, value, sizeof(value)));
+  run(&emulator, &vitoWiFi, 1);
+  TEST_ASSERT_EQUAL_UINT(0, errors);
+  TEST_ASSERT_EQUAL_UINT(1, responses);
+  TEST_ASSERT_EQUAL_UINT8(0, lastLength);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(value, emulator.get(0x0055), sizeof(value));
+  TEST_ASSERT_EQUAL_UINT32(1, emulator.stats().writes);
+
+  TEST_ASSERT_TRUE(vitoWiFi.read(dp));
+  run(&emulator, &vitoWiFi, 2);
+  TEST_ASSERT_EQUAL_UINT(0, errors);
+  TEST_ASSERT_EQUAL_UINT(2, responses);
+  TEST_ASSERT_EQUAL_UINT8(sizeof(value), lastLength);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(value, lastData, sizeof(value));
+
+  vitoWiFi.end();
+  emulator.end();
+}
+
+void test_writeVS1() {
+  roundTrip<VitoWiFi::VS1>(VitoWiFiEmulator::Protocol::VS1);
+}
+
+void test_writeGWG() {
+  roundTrip<VitoWiFi::GWG>(VitoWiFiEmulator::Protocol::GWG);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_writeVS1);
+  RUN_TEST(test_writeGWG);
+  return UNITY_END();
+}
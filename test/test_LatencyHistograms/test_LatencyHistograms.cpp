@@ -0,0 +1,125 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#include <unity.h>
+
+#include <LatencyHistograms.h>
+
+using VitoWiFi::LatencyHistogram;
+using VitoWiFi::LatencyPhase;
+using VitoWiFi::LatencySample;
+using VitoWiFi::OptolinkResult;
+using VitoWiFiInternals::RequestTimes;
+
+void setUp() {}
+void tearDown() {}
+
+LatencySample sample(uint16_t address, OptolinkResult result, uint32_t total) {
+  LatencySample sample;
+  sample.address = address;
+  sample.result = result;
+  for (std::size_t i = 0; i < VitoWiFi::NUMBER_OF_LATENCY_PHASES; ++i) {
+    sample.phases[i] = VitoWiFi::LATENCY_NOT_REACHED;
+  }
+  sample.phases[static_cast<std::size_t>(LatencyPhase::TOTAL)] = total;
+  return sample;
+}
+
+void test_buckets() {
+  LatencyHistogram histogram;
+  histogram.add(0);
+  histogram.add(1);
+  histogram.add(2);
+  histogram.add(3);
+  histogram.add(4);
+  histogram.add(16383);
+  histogram.add(16384);
+  histogram.add(UINT32_MAX);
+
+  TEST_ASSERT_EQUAL_UINT32(1, histogram.buckets[0]);
+  TEST_ASSERT_EQUAL_UINT32(1, histogram.buckets[1]);
+  TEST_ASSERT_EQUAL_UINT32(2, histogram.buckets[2]);
+  TEST_ASSERT_EQUAL_UINT32(1, histogram.buckets[3]);
+  TEST_ASSERT_EQUAL_UINT32(1, histogram.buckets[14]);
+  TEST_ASSERT_EQUAL_UINT32(2, histogram.buckets[15]);
+  TEST_ASSERT_EQUAL_UINT32(8, histogram.count);
+  TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, histogram.max);
+  TEST_ASSERT_EQUAL_UINT32(1, LatencyHistogram::bucketLimit(0));
+  TEST_ASSERT_EQUAL_UINT32(4, LatencyHistogram::bucketLimit(2));
+  TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, LatencyHistogram::bucketLimit(15));
+}
+
+void test_percentile() {
+  LatencyHistogram histogram;
+  TEST_ASSERT_EQUAL_UINT32(0, histogram.percentile(0.5f));
+
+  for (uint32_t i = 0; i < 99; ++i) histogram.add(20);
+  histogram.add(600);
+  TEST_ASSERT_EQUAL_UINT32(32, histogram.percentile(0.5f));
+  TEST_ASSERT_EQUAL_UINT32(32, histogram.percentile(0.99f));
+  TEST_ASSERT_EQUAL_UINT32(1024, histogram.percentile(1.0f));
+
+  histogram.add(20000);
+  TEST_ASSERT_EQUAL_UINT32(20000, histogram.percentile(1.0f));
+}
+
+void test_slots() {
+  VitoWiFi::LatencyHistograms<2> latencies;
+  TEST_ASSERT_TRUE(latencies.add(0x00F8));
+  latencies.record(sample(0x5525, OptolinkResult::PACKET, 100));
+  latencies.record(sample(0x5525, OptolinkResult::TIMEOUT, 4000));
+  latencies.record(sample(0x0810, OptolinkResult::PACKET, 100));
+  TEST_ASSERT_FALSE(latencies.add(0x0810));
+
+  TEST_ASSERT_EQUAL_UINT(2, latencies.size());
+  TEST_ASSERT_EQUAL_UINT16(0x00F8, latencies.address(0));
+  TEST_ASSERT_EQUAL_UINT16(0x5525, latencies.address(1));
+  TEST_ASSERT_EQUAL_UINT32(1, latencies.dropped());
+  TEST_ASSERT_EQUAL_UINT32(1, latencies.errors(0x5525));
+  TEST_ASSERT_EQUAL_UINT32(0, latencies.errors(0x0810));
+  TEST_ASSERT_NULL(latencies.histogram(0x0810, LatencyPhase::TOTAL));
+  TEST_ASSERT_EQUAL_UINT32(0, latencies.histogram(0x00F8, LatencyPhase::TOTAL)->count);
+  TEST_ASSERT_EQUAL_UINT32(2, latencies.histogram(0x5525, LatencyPhase::TOTAL)->count);
+  TEST_ASSERT_EQUAL_UINT32(0, latencies.histogram(0x5525, LatencyPhase::QUEUE)->count);
+
+  latencies.reset();
+  TEST_ASSERT_EQUAL_UINT(2, latencies.size());
+  TEST_ASSERT_EQUAL_UINT32(0, latencies.dropped());
+  TEST_ASSERT_EQUAL_UINT32(0, latencies.errors(0x5525));
+  TEST_ASSERT_EQUAL_UINT32(0, latencies.histogram(0x5525, LatencyPhase::TOTAL)->count);
+}
+
+void test_recordLatency() {
+  VitoWiFi::LatencyHistograms<1> latencies;
+  RequestTimes times;
+  times.set(RequestTimes::ENQUEUED, 1000);
+  times.set(RequestTimes::DISPATCHED, 999);  // clocks read separately
+  times.set(RequestTimes::SENT, 1020);
+  VitoWiFiInternals::recordLatency(&latencies, 0x5525, times, 4020, OptolinkResult::TIMEOUT);
+
+  times.set(RequestTimes::RESPONDED, 1060);
+  VitoWiFiInternals::recordLatency(&latencies, 0x5525, times, 1080, OptolinkResult::PACKET);
+
+  TEST_ASSERT_EQUAL_UINT32(2, latencies.histogram(0x5525, LatencyPhase::QUEUE)->buckets[0]);
+  TEST_ASSERT_EQUAL_UINT32(21, latencies.histogram(0x5525, LatencyPhase::SEND)->max);
+  TEST_ASSERT_EQUAL_UINT32(1, latencies.histogram(0x5525, LatencyPhase::RESPONSE)->count);
+  TEST_ASSERT_EQUAL_UINT32(40, latencies.histogram(0x5525, LatencyPhase::RESPONSE)->max);
+  TEST_ASSERT_EQUAL_UINT32(1, latencies.histogram(0x5525, LatencyPhase::RECEIVE)->count);
+  TEST_ASSERT_EQUAL_UINT32(20, latencies.histogram(0x5525, LatencyPhase::RECEIVE)->max);
+  TEST_ASSERT_EQUAL_UINT32(3020, latencies.histogram(0x5525, LatencyPhase::TOTAL)->max);
+  TEST_ASSERT_EQUAL_UINT32(1, latencies.errors(0x5525));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_buckets);
+  RUN_TEST(test_percentile);
+  RUN_TEST(test_slots);
+  RUN_TEST(test_recordLatency);
+  return UNITY_END();
+}
@@ -0,0 +1,156 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#include <unity.h>
+
+#include <unistd.h>
+
+#include <VitoWiFi.h>
+
+using VitoWiFi::Datapoint;
+using VitoWiFi::Priority;
+using VitoWiFi::QueueStats;
+using VitoWiFi::LinkMetrics;
+
+// counts the loops, the test sets the descriptor and timeout
+template <class BASE>
+class MockProtocol {
+ public:
+  typedef typename BASE::OnResponseCallback OnResponseCallback;
+  typedef typename BASE::OnErrorCallback OnErrorCallback;
+
+  explicit MockProtocol(MockProtocol** self)
+  : loops(0)
+  , descriptor(-1)
+  , timeout(UINT32_MAX)
+  , stats()
+  , health() {
+    *self = this;
+  }
+  void onResponse(OnResponseCallback callback) {
+    (void) callback;
+  }
+  void onError(OnErrorCallback callback) {
+    (void) callback;
+  }
+  void loop() {
+    ++loops;
+  }
+  bool isBusy() const {
+    return stats.depth > 0;
+  }
+  const QueueStats& queueStats(Priority priority) const {
+    (void) priority;
+    return stats;
+  }
+  LinkMetrics metrics() const {
+    return health;
+  }
+  int fd() const {
+    return descriptor;
+  }
+  uint32_t nextTimeout() const {
+    return timeout;
+  }
+
+  std::size_t loops;
+  int descriptor;
+  uint32_t timeout;
+  QueueStats stats;
+  LinkMetrics health;
+};
+
+typedef MockProtocol<VitoWiFi::VS2> MockVS2;
+typedef MockProtocol<VitoWiFi::VS1> MockVS1;
+
+MockVS2* link1 = nullptr;
+MockVS1* link2 = nullptr;
+VitoWiFi::VitoWiFi<MockVS2>* vitoWiFi1 = nullptr;
+VitoWiFi::VitoWiFi<MockVS1>* vitoWiFi2 = nullptr;
+VitoWiFi::LinkManager<2>* manager = nullptr;
+int pipeA[2] = {-1, -1};
+int pipeB[2] = {-1, -1};
+
+void setUp() {
+  vitoWiFi1 = new VitoWiFi::VitoWiFi<MockVS2>(&link1);
+  vitoWiFi2 = new VitoWiFi::VitoWiFi<MockVS1>(&link2);
+  manager = new VitoWiFi::LinkManager<2>;
+  TEST_ASSERT_TRUE(manager->add(vitoWiFi1));
+  TEST_ASSERT_TRUE(manager->add(vitoWiFi2));
+  TEST_ASSERT_FALSE(manager->add(vitoWiFi1));
+  TEST_ASSERT_EQUAL_INT(0, pipe(pipeA));
+  TEST_ASSERT_EQUAL_INT(0, pipe(pipeB));
+  link1->descriptor = pipeA[0];
+  link2->descriptor = pipeB[0];
+}
+
+void tearDown() {
+  close(pipeA[0]);
+  close(pipeA[1]);
+  close(pipeB[0]);
+  close(pipeB[1]);
+  delete manager;
+  delete vitoWiFi2;
+  delete vitoWiFi1;
+}
+
+void test_readiness() {
+  // nothing to do: waits for maxWait
+  TEST_ASSERT_EQUAL_UINT(0, manager->loop(10));
+  TEST_ASSERT_EQUAL_UINT(0, link1->loops + link2->loops);
+
+  // timeout due on one link
+  link2->timeout = 0;
+  TEST_ASSERT_EQUAL_UINT(1, manager->loop(1000));
+  TEST_ASSERT_EQUAL_UINT(0, link1->loops);
+  TEST_ASSERT_EQUAL_UINT(1, link2->loops);
+
+  // data on the port of the other link
+  link2->timeout = UINT32_MAX;
+  const uint8_t data = 0x05;
+  TEST_ASSERT_EQUAL_INT(1, write(pipeA[1], &data, 1));
+  TEST_ASSERT_EQUAL_UINT(1, manager->loop(1000));
+  TEST_ASSERT_EQUAL_UINT(1, link1->loops);
+  TEST_ASSERT_EQUAL_UINT(1, link2->loops);
+  TEST_ASSERT_EQUAL_UINT32(3, manager->wakeups());
+  TEST_ASSERT_EQUAL_UINT32(2, manager->serviced());
+}
+
+void test_metrics() {
+  link1->stats.enqueued = 3;
+  link1->stats.depth = 1;
+  link1->stats.maxWait = 40;
+  link2->stats.enqueued = 2;
+  link2->stats.maxWait = 70;
+
+  QueueStats stats = manager->queueStats(Priority::INTERACTIVE_READ);
+  TEST_ASSERT_EQUAL_UINT32(5, stats.enqueued);
+  TEST_ASSERT_EQUAL_UINT8(1, stats.depth);
+  TEST_ASSERT_EQUAL_UINT32(70, stats.maxWait);
+  TEST_ASSERT_EQUAL_UINT(1, manager->busyLinks());
+
+  link1->health.results[static_cast<std::size_t>(VitoWiFi::OptolinkResult::PACKET)] = 10;
+  link1->health.resets = 1;
+  link1->health.stateTime[2] = 500;
+  link2->health.results[static_cast<std::size_t>(VitoWiFi::OptolinkResult::PACKET)] = 4;
+  link2->health.bytesSent = 30;
+
+  LinkMetrics metrics = manager->metrics();
+  TEST_ASSERT_EQUAL_UINT32(14, metrics.results[static_cast<std::size_t>(VitoWiFi::OptolinkResult::PACKET)]);
+  TEST_ASSERT_EQUAL_UINT32(1, metrics.resets);
+  TEST_ASSERT_EQUAL_UINT32(30, metrics.bytesSent);
+  TEST_ASSERT_EQUAL_UINT32(0, metrics.stateTime[2]);
+  TEST_ASSERT_EQUAL_UINT32(500, manager->metrics(0).stateTime[2]);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_readiness);
+  RUN_TEST(test_metrics);
+  return UNITY_END();
+}
@@ -11,6 +11,7 @@ the LICENSE file.
 #include <VS2/PacketVS2.h>
 
 using VitoWiFi::PacketVS2;
+using VitoWiFi::StaticPacketVS2;
 using VitoWiFi::PacketType;
 using VitoWiFi::FunctionCode;
 
@@ -97,6 +98,35 @@ void test_packetId() {
   TEST_ASSERT_EQUAL_UINT8(checksum, packet.checksum());
 }
 
+void test_responseRead() {
+  const uint8_t data[] = {
+    0x07,  // length
+    0x01,  // packet type (response)
+    0x01,  // flags: id + function code (0 + read)
+    0x55,  // address 1
+    0x25,  // address 2
+    0x02,  // payload length
+    0x07,  // payload
+    0x01
+  };
+  const std::size_t length = 8;
+  const uint8_t checksum = 0x8D;
+
+  uint8_t payload[2] = {0x07, 0x01};
+  PacketVS2 packet;
+  packet.createPacket(PacketType::RESPONSE,
+                      FunctionCode::READ,
+                      0,
+                      0x5525,
+                      2,
+                      payload);
+
+  TEST_ASSERT_TRUE(packet);
+  TEST_ASSERT_EQUAL(length, packet.length());
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(data, &packet[0], length);
+  TEST_ASSERT_EQUAL_UINT8(checksum, packet.checksum());
+}
+
 void test_payloadLength() {
   PacketVS2 packet;
   packet.createPacket(PacketType::REQUEST,
@@ -119,12 +149,59 @@ void test_payloadData() {
   TEST_ASSERT_FALSE(packet ? true : false);  // contextually convert to bool
 }
 
+void test_staticPacket() {
+  const uint8_t data[] = {
+    0x07,  // length
+    0x00,  // packet type (request)
+    0x02,  // flags: id + function code (0 + write)
+    0x23,  // address 1
+    0x23,  // address 2
+    0x02,  // payload length
+    0x01,  // payload
+    0x02
+  };
+  const std::size_t length = 8;
+  uint8_t payload[3] = {0x01, 0x02, 0x03};
+
+  StaticPacketVS2<2> packet;
+  TEST_ASSERT_TRUE(packet.createPacket(PacketType::REQUEST,
+                                       FunctionCode::WRITE,
+                                       0,
+                                       0x2323,
+                                       2,
+                                       payload));
+  TEST_ASSERT_EQUAL(length, packet.length());
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(data, &packet[0], length);
+
+  // payload doesn't fit
+  TEST_ASSERT_FALSE(packet.createPacket(PacketType::REQUEST,
+                                        FunctionCode::WRITE,
+                                        0,
+                                        0x2323,
+                                        3,
+                                        payload));
+  TEST_ASSERT_FALSE(packet.setLength(8));
+  TEST_ASSERT_TRUE(packet.setLength(7));
+}
+
+void test_checksumAfterChange() {
+  PacketVS2 packet;
+  packet.createPacket(PacketType::REQUEST, FunctionCode::READ, 0, 0x5525, 2);
+  TEST_ASSERT_EQUAL_UINT8(0x82, packet.checksum());
+
+  packet[5] = 0x04;
+  TEST_ASSERT_EQUAL_UINT8(0x84, packet.checksum());
+}
+
 int main() {
   UNITY_BEGIN();
   RUN_TEST(test_ok_requestRead);
   RUN_TEST(test_ok_requestWrite);
   RUN_TEST(test_packetId);
+  RUN_TEST(test_responseRead);
   RUN_TEST(test_payloadLength);
   RUN_TEST(test_payloadData);
+  RUN_TEST(test_staticPacket);
+  RUN_TEST(test_checksumAfterChange);
   return UNITY_END();
 }
\ No newline at end of file
@@ -204,6 +204,62 @@ void test_spuriousbytes() {
   TEST_ASSERT_EQUAL_UINT8_ARRAY(data, parser.packet().data(), 2);
 }
 
+void test_chunked() {
+  const uint8_t stream[] = {
+    0x41, 0x07, 0x01, 0x01, 0x55, 0x25, 0x02, 0x07, 0x01, 0x8D,  // response 1
+    0x41, 0x07, 0x01, 0x21, 0x08, 0x10, 0x02, 0x12, 0x34, 0x89   // response 2, id 1
+  };
+  const uint8_t data[2] = {0x12, 0x34};
+  std::size_t consumed = 0;
+
+  // stops at the end of the first packet
+  TEST_ASSERT_EQUAL(ParserResult::COMPLETE, parser.parse(stream, sizeof(stream), &consumed));
+  TEST_ASSERT_EQUAL_UINT(10, consumed);
+  TEST_ASSERT_EQUAL_UINT16(0x5525, parser.packet().address());
+  TEST_ASSERT_EQUAL_UINT8(0x8D, parser.packet().checksum());
+
+  // second packet split in the middle of the payload
+  TEST_ASSERT_EQUAL(ParserResult::CONTINUE, parser.parse(&stream[10], 8, &consumed));
+  TEST_ASSERT_EQUAL_UINT(8, consumed);
+  TEST_ASSERT_EQUAL(ParserResult::COMPLETE, parser.parse(&stream[18], 2, &consumed));
+  TEST_ASSERT_EQUAL_UINT(2, consumed);
+  TEST_ASSERT_EQUAL_UINT8(0x01, parser.packet().id());
+  TEST_ASSERT_EQUAL_UINT16(0x0810, parser.packet().address());
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(data, parser.packet().data(), 2);
+}
+
+void test_resync() {
+  const uint8_t stream[] = {
+    0x41,  // false start byte
+    0x09,  // noise, taken as length
+    0x41,  // start byte, taken as packet type (invalid)
+    0x07,  // length
+    0x01,  // packet type (response)
+    0x01,  // flags: id + function code (0 + read)
+    0x55,  // address 1
+    0x25,  // address 2
+    0x02,  // payload length
+    0x07,  // payload
+    0x01,
+    0x8D   // cs
+  };
+  const uint8_t data[2] = {0x07, 0x01};
+  std::size_t errors = 0;
+  uint32_t resyncs = parser.resyncs();  // not cleared between tests
+  ParserResult result = ParserResult::ERROR;
+
+  for (std::size_t i = 0; i < sizeof(stream); ++i) {
+    result = parser.parse(stream[i]);
+    if (result == ParserResult::ERROR) ++errors;
+  }
+
+  TEST_ASSERT_EQUAL_UINT(1, errors);
+  TEST_ASSERT_EQUAL_UINT32(1, parser.resyncs() - resyncs);
+  TEST_ASSERT_EQUAL(ParserResult::COMPLETE, result);
+  TEST_ASSERT_EQUAL_UINT16(0x5525, parser.packet().address());
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(data, parser.packet().data(), 2);
+}
+
 void test_invalidLength() {
   const uint8_t stream[] = {
     0x41,  // start byte
@@ -320,6 +376,33 @@ void test_invalidChecksum() {
   TEST_ASSERT_EQUAL_UINT(10, bytesRead);
 }
 
+void test_reset() {
+  const uint8_t partial[] = {0x41, 0x07, 0x01, 0x01, 0x55};
+  const uint8_t stream[] = {
+    0x41,  // start byte
+    0x05,  // length
+    0x00,  // packet type (request)
+    0x01,  // flags: id + function code (0 + read)
+    0x55,  // address 1
+    0x25,  // address 2
+    0x02,  // payload length
+    0x82   // cs
+  };
+
+  for (std::size_t i = 0; i < sizeof(partial); ++i) {
+    TEST_ASSERT_EQUAL(ParserResult::CONTINUE, parser.parse(partial[i]));
+  }
+  TEST_ASSERT_FALSE(parser.isIdle());
+  parser.reset();
+  TEST_ASSERT_TRUE(parser.isIdle());
+
+  std::size_t consumed = 0;
+  TEST_ASSERT_EQUAL(ParserResult::COMPLETE, parser.parse(stream, sizeof(stream), &consumed));
+  TEST_ASSERT_EQUAL_UINT(sizeof(stream), consumed);
+  TEST_ASSERT_EQUAL_UINT16(0x5525, parser.packet().address());
+  TEST_ASSERT_EQUAL_UINT8(0x82, parser.packet().checksum());
+}
+
 int main() {
   UNITY_BEGIN();
   RUN_TEST(test_ok_request);
@@ -327,9 +410,12 @@ int main() {
   RUN_TEST(test_nok_readresponse);
   RUN_TEST(test_ok_writeresponse);
   RUN_TEST(test_spuriousbytes);
+  RUN_TEST(test_chunked);
+  RUN_TEST(test_resync);
   RUN_TEST(test_invalidLength);
   RUN_TEST(test_invalidPacketType);
   RUN_TEST(test_invalidFunctionCode);
   RUN_TEST(test_invalidChecksum);
+  RUN_TEST(test_reset);
   return UNITY_END();
 }
\ No newline at end of file
@@ -0,0 +1,112 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#include <unity.h>
+
+#include <thread>
+#include <chrono>
+
+#include <VitoWiFi.h>
+
+using VitoWiFi::Datapoint;
+using VitoWiFi::Priority;
+
+class MockProtocol;
+MockProtocol* protocol = nullptr;
+
+// records the requests instead of talking to a device
+class MockProtocol {
+ public:
+  typedef VitoWiFi::VS1::OnResponseCallback OnResponseCallback;
+  typedef VitoWiFi::VS1::OnErrorCallback OnErrorCallback;
+
+  explicit MockProtocol(void* interface)
+  : busy(false)
+  , reads(0)
+  , lastRead(nullptr)
+  , lastPriority(Priority::INTERACTIVE_READ) {
+    (void) interface;
+    protocol = this;
+  }
+  void onResponse(OnResponseCallback callback) {
+    (void) callback;
+  }
+  void onError(OnErrorCallback callback) {
+    (void) callback;
+  }
+  bool read(const Datapoint& datapoint, Priority priority) {
+    ++reads;
+    lastRead = datapoint.name();
+    lastPriority = priority;
+    return true;
+  }
+  bool isBusy() const {
+    return busy;
+  }
+
+  bool busy;
+  std::size_t reads;
+  const char* lastRead;
+  Priority lastPriority;
+};
+
+Datapoint fast("fast", 0x0810, 2, VitoWiFi::div10);
+Datapoint slow("slow", 0x5525, 2, VitoWiFi::div10);
+
+VitoWiFi::VitoWiFi<MockProtocol>* vitoWiFi = nullptr;
+VitoWiFi::Poller<MockProtocol, 2>* poller = nullptr;
+
+void setUp() {
+  vitoWiFi = new VitoWiFi::VitoWiFi<MockProtocol>(static_cast<void*>(nullptr));
+  poller = new VitoWiFi::Poller<MockProtocol, 2>(vitoWiFi);
+  poller->add(fast, 50);
+  poller->add(slow, 10000);
+}
+
+void tearDown() {
+  delete poller;
+  delete vitoWiFi;
+}
+
+void test_intervals() {
+  TEST_ASSERT_EQUAL_UINT32(0, poller->nextDue());
+
+  // everything is due at start, one request per loop
+  poller->loop();
+  TEST_ASSERT_EQUAL_STRING("fast", protocol->lastRead);
+  TEST_ASSERT(Priority::BACKGROUND == protocol->lastPriority);
+  poller->loop();
+  TEST_ASSERT_EQUAL_STRING("slow", protocol->lastRead);
+  poller->loop();
+  TEST_ASSERT_EQUAL_UINT(2, protocol->reads);
+
+  uint32_t nextDue = poller->nextDue();
+  TEST_ASSERT_TRUE(nextDue > 0 && nextDue <= 50);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(60));
+  TEST_ASSERT_EQUAL_UINT32(0, poller->nextDue());
+  poller->loop();
+  TEST_ASSERT_EQUAL_UINT(3, protocol->reads);
+  TEST_ASSERT_EQUAL_STRING("fast", protocol->lastRead);
+}
+
+void test_busy() {
+  protocol->busy = true;
+  poller->loop();
+  TEST_ASSERT_EQUAL_UINT(0, protocol->reads);
+  protocol->busy = false;
+  poller->loop();
+  TEST_ASSERT_EQUAL_UINT(1, protocol->reads);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_intervals);
+  RUN_TEST(test_busy);
+  return UNITY_END();
+}
@@ -0,0 +1,259 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#include <unity.h>
+
+#include <cstring>
+
+#include <VitoWiFi.h>
+
+using VitoWiFi::Datapoint;
+using VitoWiFi::OptolinkResult;
+
+class MockInterface {
+ public:
+  MockInterface()
+  : txLength(0)
+  , rxLength(0)
+  , rxPosition(0) {}
+  bool begin() { return true; }
+  void end() {}
+  std::size_t write(const uint8_t* data, uint8_t length) {
+    std::memcpy(&tx[txLength], data, length);
+    txLength += length;
+    return length;
+  }
+  uint8_t read() {
+    return rx[rxPosition++];
+  }
+  size_t available() {
+    return rxLength - rxPosition;
+  }
+  void feed(const uint8_t* data, std::size_t length) {
+    std::memcpy(&rx[rxLength], data, length);
+    rxLength += length;
+  }
+
+  uint8_t tx[256];
+  std::size_t txLength;
+  uint8_t rx[256];
+  std::size_t rxLength;
+  std::size_t rxPosition;
+};
+
+Datapoint datapoints[] = {
+  Datapoint("outsidetemp", 0x5525, 2, VitoWiFi::div10),
+  Datapoint("boilertemp", 0x0810, 2, VitoWiFi::div10),
+  Datapoint("flowtemp", 0x0812, 2, VitoWiFi::div10),
+  Datapoint("pump", 0x0815, 1, VitoWiFi::noconv)
+};
+
+MockInterface* mockInterface = nullptr;
+VitoWiFi::VitoWiFi<VitoWiFi::VS1>* vitoWiFi = nullptr;
+VitoWiFi::ReadPlanner<VitoWiFi::VS1, 4>* planner = nullptr;
+std::size_t responses = 0;
+std::size_t errors = 0;
+float values[3] = {0};
+
+void setUp() {
+  mockInterface = new MockInterface;
+  vitoWiFi = new VitoWiFi::VitoWiFi<VitoWiFi::VS1>(mockInterface);
+  planner = new VitoWiFi::ReadPlanner<VitoWiFi::VS1, 4>(vitoWiFi);
+  responses = 0;
+  errors = 0;
+  planner->onResponse([](const uint8_t* data, uint8_t length, const Datapoint& request) {
+    if (responses < 3) {
+      values[responses] = request.decode(data, length);
+    }
+    ++responses;
+  });
+  planner->onError([](OptolinkResult error, const Datapoint& request) {
+    (void) error;
+    (void) request;
+    ++errors;
+  });
+  for (const Datapoint& datapoint : datapoints) {
+    planner->add(datapoint);
+  }
+  vitoWiFi->begin();
+}
+
+void tearDown() {
+  delete planner;
+  delete vitoWiFi;
+  delete mockInterface;
+}
+
+void test_plan() {
+  TEST_ASSERT_EQUAL_UINT(2, planner->numberOfBlocks());
+}
+
+void test_splitResponse() {
+  const uint8_t enq[] = {0x05};
+  const uint8_t response[] = {0x07, 0x01, 0xF6, 0x00, 0xFF, 0x01};
+  const uint8_t expected[] = {0x01, 0xF7, 0x08, 0x10, 0x06};
+
+  TEST_ASSERT_TRUE(planner->read());
+  mockInterface->feed(enq, 1);
+  vitoWiFi->loop();
+  vitoWiFi->loop();
+  TEST_ASSERT_EQUAL_UINT(sizeof(expected), mockInterface->txLength);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, mockInterface->tx, sizeof(expected));
+
+  mockInterface->feed(response, sizeof(response));
+  vitoWiFi->loop();
+
+  TEST_ASSERT_EQUAL_UINT(3, responses);
+  TEST_ASSERT_EQUAL_UINT(0, errors);
+  TEST_ASSERT_EQUAL_FLOAT(26.3f, values[0]);
+  TEST_ASSERT_EQUAL_FLOAT(24.6f, values[1]);
+
+  // second block is queued in VitoWiFi
+  TEST_ASSERT_FALSE(planner->isBusy());
+  TEST_ASSERT_TRUE(vitoWiFi->isBusy());
+}
+
+void test_splitPacket() {
+  VitoWiFi::VitoWiFi<VitoWiFi::VS2> vitoWiFiVS2(mockInterface);
+  VitoWiFi::ReadPlanner<VitoWiFi::VS2, 4> plannerVS2(&vitoWiFiVS2);
+  uint16_t addresses[3] = {0};
+  plannerVS2.onResponse([&addresses](const VitoWiFi::PacketVS2& response, const Datapoint& request) {
+    if (responses < 3) {
+      values[responses] = request.decode(response);
+      addresses[responses] = response.address();
+    }
+    ++responses;
+  });
+  for (const Datapoint& datapoint : datapoints) {
+    plannerVS2.add(datapoint);
+  }
+
+  // connect
+  const uint8_t enq[] = {0x05};
+  const uint8_t ack[] = {0x06};
+  vitoWiFiVS2.begin();
+  vitoWiFiVS2.loop();
+  mockInterface->feed(enq, 1);
+  vitoWiFiVS2.loop();
+  vitoWiFiVS2.loop();
+  mockInterface->feed(ack, 1);
+  vitoWiFiVS2.loop();
+
+  TEST_ASSERT_TRUE(plannerVS2.read());
+  TEST_ASSERT_FALSE(plannerVS2.isBusy());  // both blocks queued
+  for (std::size_t i = 0; i < 4; ++i) vitoWiFiVS2.loop();
+
+  const uint8_t response[] = {0x06, 0x41, 0x0B, 0x01, 0x01, 0x08, 0x10, 0x06, 0x07, 0x01, 0xF6, 0x00, 0xFF, 0x01, 0x29};
+  mockInterface->feed(response, sizeof(response));
+  vitoWiFiVS2.loop();
+  vitoWiFiVS2.loop();
+
+  TEST_ASSERT_EQUAL_UINT(3, responses);
+  TEST_ASSERT_EQUAL_FLOAT(26.3f, values[0]);
+  TEST_ASSERT_EQUAL_FLOAT(24.6f, values[1]);
+  TEST_ASSERT_EQUAL_UINT16(0x0815, addresses[2]);
+}
+
+void test_lookalikeRequest() {
+  // same name, address and length as the first block but not read by the planner
+  Datapoint lookalike("read block", 0x0810, 6, VitoWiFi::noconv);
+  const char* lastName = nullptr;
+  planner->onResponse([&lastName](const uint8_t* data, uint8_t length, const Datapoint& request) {
+    (void) data;
+    (void) length;
+    lastName = request.name();
+    ++responses;
+  });
+  const uint8_t enq[] = {0x05};
+  const uint8_t response[] = {0x07, 0x01, 0xF6, 0x00, 0xFF, 0x01};
+
+  TEST_ASSERT_TRUE(vitoWiFi->read(lookalike));
+  mockInterface->feed(enq, 1);
+  vitoWiFi->loop();
+  vitoWiFi->loop();
+  mockInterface->feed(response, sizeof(response));
+  vitoWiFi->loop();
+
+  // passed through, not split
+  TEST_ASSERT_EQUAL_UINT(1, responses);
+  TEST_ASSERT_EQUAL_STRING("read block", lastName);
+}
+
+void test_twoPlanners() {
+  VitoWiFi::ReadPlanner<VitoWiFi::VS1, 4> other(vitoWiFi);
+  std::size_t otherResponses = 0;
+  other.onResponse([&otherResponses](const uint8_t* data, uint8_t length, const Datapoint& request) {
+    (void) data;
+    (void) length;
+    (void) request;
+    ++otherResponses;
+  });
+  for (const Datapoint& datapoint : datapoints) {
+    other.add(datapoint);
+  }
+  TEST_ASSERT_EQUAL_UINT(2, other.numberOfBlocks());
+  const uint8_t enq[] = {0x05};
+  const uint8_t response[] = {0x07, 0x01, 0xF6, 0x00, 0xFF, 0x01};
+
+  TEST_ASSERT_TRUE(planner->read());
+  mockInterface->feed(enq, 1);
+  vitoWiFi->loop();
+  vitoWiFi->loop();
+  mockInterface->feed(response, sizeof(response));
+  vitoWiFi->loop();
+
+  // only the planner that read the block splits it, the other one passes it through
+  TEST_ASSERT_EQUAL_UINT(3, responses);
+  TEST_ASSERT_EQUAL_UINT(1, otherResponses);
+}
+
+void test_stackedFilter() {
+  VitoWiFi::ChangeFilter<VitoWiFi::VS1, 4> filter(planner);
+  std::size_t filtered = 0;
+  filter.onResponse([&filtered](const uint8_t* data, uint8_t length, const Datapoint& request) {
+    (void) data;
+    (void) length;
+    (void) request;
+    ++filtered;
+  });
+  for (const Datapoint& datapoint : datapoints) {
+    filter.add(datapoint);
+  }
+  const uint8_t enq[] = {0x05};
+  const uint8_t response[] = {0x07, 0x01, 0xF6, 0x00, 0xFF, 0x01};
+  mockInterface->feed(enq, 1);
+
+  // the filter sees the split responses, not the block
+  for (std::size_t cycle = 0; cycle < 2; ++cycle) {
+    TEST_ASSERT_TRUE(planner->read());
+    vitoWiFi->loop();
+    vitoWiFi->loop();
+    mockInterface->feed(response, sizeof(response));
+    vitoWiFi->loop();
+    vitoWiFi->loop();
+    const uint8_t outside[] = {0x07, 0x01};
+    mockInterface->feed(outside, sizeof(outside));
+    vitoWiFi->loop();
+    vitoWiFi->loop();
+  }
+  TEST_ASSERT_EQUAL_UINT(8, responses);
+  TEST_ASSERT_EQUAL_UINT(0, errors);
+  TEST_ASSERT_EQUAL_UINT(4, filtered);
+  TEST_ASSERT_EQUAL_UINT32(4, filter.suppressed());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_plan);
+  RUN_TEST(test_splitResponse);
+  RUN_TEST(test_splitPacket);
+  RUN_TEST(test_lookalikeRequest);
+  RUN_TEST(test_twoPlanners);
+  RUN_TEST(test_stackedFilter);
+  return UNITY_END();
+}
@@ -0,0 +1,183 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#include <unity.h>
+
+#include <thread>
+#include <chrono>
+
+#include <VitoWiFi.h>
+
+using VitoWiFi::Datapoint;
+using VitoWiFi::Priority;
+
+class MockProtocol;
+MockProtocol* protocol = nullptr;
+
+// records the requests and lets the test trigger the callbacks
+class MockProtocol {
+ public:
+  typedef VitoWiFi::VS1::OnResponseCallback OnResponseCallback;
+  typedef VitoWiFi::VS1::OnErrorCallback OnErrorCallback;
+
+  explicit MockProtocol(void* interface)
+  : busy(false)
+  , reads(0)
+  , writes(0)
+  , lastRead(nullptr, 0, 0, VitoWiFi::noconv)
+  , onResponseCallback(nullptr)
+  , onErrorCallback(nullptr) {
+    (void) interface;
+    protocol = this;
+  }
+  void onResponse(OnResponseCallback callback) {
+    onResponseCallback = callback;
+  }
+  void onError(OnErrorCallback callback) {
+    onErrorCallback = callback;
+  }
+  bool read(const Datapoint& datapoint, Priority priority) {
+    (void) priority;
+    ++reads;
+    lastRead = datapoint;
+    return true;
+  }
+  bool write(const Datapoint& datapoint, const uint8_t* data, uint8_t length, Priority priority) {
+    (void) data;
+    (void) length;
+    (void) priority;
+    ++writes;
+    lastRead = datapoint;
+    return true;
+  }
+  bool isBusy() const {
+    return busy;
+  }
+  void respond() {
+    const uint8_t data[2] = {0x07, 0x01};
+    onResponseCallback(data, lastRead.length(), lastRead);
+  }
+
+  bool busy;
+  std::size_t reads;
+  std::size_t writes;
+  Datapoint lastRead;
+  OnResponseCallback onResponseCallback;
+  OnErrorCallback onErrorCallback;
+};
+
+Datapoint outside("outsidetemp", 0x5525, 2, VitoWiFi::div10);
+Datapoint boiler("boilertemp", 0x0810, 2, VitoWiFi::div10);
+
+VitoWiFi::VitoWiFi<MockProtocol>* vitoWiFi = nullptr;
+VitoWiFi::ResponseCache<MockProtocol, 2>* cache = nullptr;
+std::size_t responses = 0;
+float lastValue = 0;
+
+void setUp() {
+  vitoWiFi = new VitoWiFi::VitoWiFi<MockProtocol>(static_cast<void*>(nullptr));
+  cache = new VitoWiFi::ResponseCache<MockProtocol, 2>(vitoWiFi);
+  responses = 0;
+  lastValue = 0;
+  cache->onResponse([](const uint8_t* data, uint8_t length, const Datapoint& request) {
+    lastValue = request.decode(data, length);
+    ++responses;
+  });
+}
+
+void tearDown() {
+  delete cache;
+  delete vitoWiFi;
+}
+
+void test_hit() {
+  cache->add(outside, 1000);
+
+  TEST_ASSERT_TRUE(cache->read(outside));
+  protocol->respond();
+  TEST_ASSERT_EQUAL_UINT(1, protocol->reads);
+  TEST_ASSERT_EQUAL_UINT(1, responses);
+
+  // answered from memory on the next loop
+  lastValue = 0;
+  TEST_ASSERT_TRUE(cache->read(outside));
+  TEST_ASSERT_EQUAL_UINT(1, responses);
+  cache->loop();
+  TEST_ASSERT_EQUAL_UINT(1, protocol->reads);
+  TEST_ASSERT_EQUAL_UINT(2, responses);
+  TEST_ASSERT_EQUAL_FLOAT(26.3f, lastValue);
+  TEST_ASSERT_EQUAL_UINT32(1, cache->hits());
+  TEST_ASSERT_EQUAL_UINT32(1, cache->misses());
+
+  // not registered
+  cache->read(boiler);
+  cache->loop();
+  TEST_ASSERT_EQUAL_UINT(2, protocol->reads);
+}
+
+void test_expired() {
+  cache->add(outside, 50);
+  cache->read(outside);
+  protocol->respond();
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(60));
+  cache->read(outside);
+  cache->loop();
+  TEST_ASSERT_EQUAL_UINT(2, protocol->reads);
+  TEST_ASSERT_EQUAL_UINT32(0, cache->hits());
+
+  protocol->respond();
+  cache->invalidate();
+  cache->read(outside);
+  TEST_ASSERT_EQUAL_UINT(3, protocol->reads);
+}
+
+void test_error() {
+  cache->add(outside, 1000);
+  cache->read(outside);
+  protocol->onErrorCallback(VitoWiFi::OptolinkResult::TIMEOUT, outside);
+
+  // nothing cached
+  cache->read(outside);
+  TEST_ASSERT_EQUAL_UINT(2, protocol->reads);
+}
+
+void test_write() {
+  cache->add(outside, 60000);
+  cache->read(outside);
+  protocol->respond();
+  cache->read(outside);
+  cache->loop();
+  TEST_ASSERT_EQUAL_UINT(1, protocol->reads);
+
+  const uint8_t value[2] = {0xC8, 0x00};
+  TEST_ASSERT_TRUE(cache->write(outside, value));
+  TEST_ASSERT_EQUAL_UINT(1, protocol->writes);
+  cache->read(outside);
+  TEST_ASSERT_EQUAL_UINT(2, protocol->reads);
+
+  protocol->respond();
+  cache->read(outside);
+  cache->loop();
+  TEST_ASSERT_EQUAL_UINT(2, protocol->reads);
+
+  // a response that wasn't asked for through the cache drops the value as well
+  vitoWiFi->write(outside, value);
+  protocol->respond();
+  cache->read(outside);
+  TEST_ASSERT_EQUAL_UINT(3, protocol->reads);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_hit);
+  RUN_TEST(test_expired);
+  RUN_TEST(test_error);
+  RUN_TEST(test_write);
+  return UNITY_END();
+}
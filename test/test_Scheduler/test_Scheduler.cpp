@@ -0,0 +1,146 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#include <unity.h>
+
+#include <thread>
+#include <chrono>
+
+#include <VitoWiFi.h>
+
+using VitoWiFi::Datapoint;
+using VitoWiFi::Priority;
+
+class MockProtocol;
+MockProtocol* protocol = nullptr;
+
+// records the requests and lets the test trigger the callbacks
+class MockProtocol {
+ public:
+  typedef VitoWiFi::VS1::OnResponseCallback OnResponseCallback;
+  typedef VitoWiFi::VS1::OnErrorCallback OnErrorCallback;
+
+  explicit MockProtocol(void* interface)
+  : busy(false)
+  , reads(0)
+  , lastRead(nullptr, 0, 0, VitoWiFi::noconv)
+  , onResponseCallback(nullptr)
+  , onErrorCallback(nullptr) {
+    (void) interface;
+    protocol = this;
+  }
+  void onResponse(OnResponseCallback callback) {
+    onResponseCallback = callback;
+  }
+  void onError(OnErrorCallback callback) {
+    onErrorCallback = callback;
+  }
+  bool read(const Datapoint& datapoint, Priority priority) {
+    (void) priority;
+    ++reads;
+    lastRead = datapoint;
+    return true;
+  }
+  bool isBusy() const {
+    return busy;
+  }
+  void respond() {
+    const uint8_t data[2] = {0x07, 0x01};
+    onResponseCallback(data, lastRead.length(), lastRead);
+  }
+
+  bool busy;
+  std::size_t reads;
+  Datapoint lastRead;
+  OnResponseCallback onResponseCallback;
+  OnErrorCallback onErrorCallback;
+};
+
+Datapoint outside("outsidetemp", 0x5525, 2, VitoWiFi::div10);
+Datapoint boiler("boilertemp", 0x0810, 2, VitoWiFi::div10);
+
+VitoWiFi::VitoWiFi<MockProtocol>* vitoWiFi = nullptr;
+VitoWiFi::Scheduler<MockProtocol, 2>* scheduler = nullptr;
+std::size_t responses = 0;
+
+void setUp() {
+  vitoWiFi = new VitoWiFi::VitoWiFi<MockProtocol>(static_cast<void*>(nullptr));
+  scheduler = new VitoWiFi::Scheduler<MockProtocol, 2>(vitoWiFi);
+  responses = 0;
+  scheduler->onResponse([](const uint8_t* data, uint8_t length, const Datapoint& request) {
+    (void) data;
+    (void) length;
+    (void) request;
+    ++responses;
+  });
+}
+
+void tearDown() {
+  delete scheduler;
+  delete vitoWiFi;
+}
+
+void test_earliestDeadline() {
+  scheduler->add(outside, 10000);
+  scheduler->add(boiler, 200);
+
+  // initial reads
+  scheduler->loop();
+  protocol->respond();
+  scheduler->loop();
+  protocol->respond();
+  TEST_ASSERT_EQUAL_UINT(2, protocol->reads);
+  TEST_ASSERT_EQUAL_UINT(2, responses);
+  uint32_t rtt = scheduler->roundTripTime(boiler);
+  TEST_ASSERT_TRUE(rtt >= 75 && rtt < 80);  // moving average from the default of 100
+
+  // not due yet
+  scheduler->loop();
+  TEST_ASSERT_EQUAL_UINT(2, protocol->reads);
+
+  // boiler's deadline is closer than the time to read everything
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  scheduler->loop();
+  TEST_ASSERT_EQUAL_UINT(3, protocol->reads);
+  TEST_ASSERT_EQUAL_UINT16(boiler.address(), protocol->lastRead.address());
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler->deadlineMisses());
+}
+
+void test_deadlineMiss() {
+  scheduler->add(boiler, 50);
+  scheduler->loop();
+  protocol->respond();
+
+  protocol->busy = true;
+  std::this_thread::sleep_for(std::chrono::milliseconds(60));
+  scheduler->loop();
+  scheduler->loop();
+  TEST_ASSERT_EQUAL_UINT32(1, scheduler->deadlineMisses());
+
+  protocol->busy = false;
+  scheduler->loop();
+  protocol->respond();
+  scheduler->loop();
+  TEST_ASSERT_EQUAL_UINT32(1, scheduler->deadlineMisses());
+}
+
+void test_utilization() {
+  scheduler->add(outside, 1000);
+  TEST_ASSERT_TRUE(scheduler->feasible());
+  scheduler->add(boiler, 100);
+  TEST_ASSERT_EQUAL_FLOAT(1.1f, scheduler->utilization());
+  TEST_ASSERT_FALSE(scheduler->feasible());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_earliestDeadline);
+  RUN_TEST(test_deadlineMiss);
+  RUN_TEST(test_utilization);
+  return UNITY_END();
+}
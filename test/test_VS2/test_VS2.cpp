@@ -0,0 +1,582 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#include <unity.h>
+
+#include <cstring>
+#include <thread>
+#include <chrono>
+
+#include <VS2/VS2.h>
+
+using VitoWiFi::VS2;
+using VitoWiFi::PacketVS2;
+using VitoWiFi::Datapoint;
+using VitoWiFi::OptolinkResult;
+
+class MockInterface {
+ public:
+  MockInterface()
+  : txLength(0)
+  , rxLength(0)
+  , rxPosition(0) {}
+  bool begin() { return true; }
+  void end() {}
+  std::size_t write(const uint8_t* data, uint8_t length) {
+    std::memcpy(&tx[txLength], data, length);
+    txLength += length;
+    return length;
+  }
+  uint8_t read() {
+    return rx[rxPosition++];
+  }
+  size_t available() {
+    return rxLength - rxPosition;
+  }
+  void feed(const uint8_t* data, std::size_t length) {
+    std::memcpy(&rx[rxLength], data, length);
+    rxLength += length;
+  }
+  void clear() {
+    txLength = 0;
+  }
+
+  uint8_t tx[256];
+  std::size_t txLength;
+  uint8_t rx[256];
+  std::size_t rxLength;
+  std::size_t rxPosition;
+};
+
+MockInterface* mockInterface = nullptr;
+VS2* vs2 = nullptr;
+std::size_t responses = 0;
+std::size_t errors = 0;
+uint16_t lastAddress = 0;
+uint8_t lastRetries = 0;
+OptolinkResult lastError = OptolinkResult::CONTINUE;
+
+const uint8_t enq[] = {0x05};
+const uint8_t ack[] = {0x06};
+const uint8_t response[] = {0x41, 0x07, 0x01, 0x01, 0x55, 0x25, 0x02, 0x07, 0x01, 0x8D};
+
+void loop(std::size_t times) {
+  for (std::size_t i = 0; i < times; ++i) {
+    vs2->loop();
+  }
+}
+
+void setUp() {
+  mockInterface = new MockInterface;
+  vs2 = new VS2(mockInterface);
+  responses = 0;
+  errors = 0;
+  lastAddress = 0;
+  lastRetries = 0;
+  lastError = OptolinkResult::CONTINUE;
+  vs2->onResponse([](const PacketVS2& response, const Datapoint& request) {
+    (void) response;
+    ++responses;
+    lastAddress = request.address();
+    lastRetries = vs2->retries();
+  });
+  vs2->onError([](OptolinkResult error, const Datapoint& request) {
+    (void) request;
+    ++errors;
+    lastError = error;
+    lastRetries = vs2->retries();
+  });
+  // connect: EOT --> ENQ, SYNC --> ACK
+  vs2->begin();
+  loop(1);
+  mockInterface->feed(enq, 1);
+  loop(2);
+  mockInterface->feed(ack, 1);
+  loop(1);
+  mockInterface->clear();
+}
+
+void tearDown() {
+  delete vs2;
+  delete mockInterface;
+}
+
+void test_queueRequests() {
+  Datapoint dp1("dp1", 0x5525, 2, VitoWiFi::div10);
+  Datapoint dp2("dp2", 0x0810, 2, VitoWiFi::div10);
+
+  TEST_ASSERT_TRUE(vs2->read(dp1));
+  TEST_ASSERT_TRUE(vs2->read(dp2));
+  TEST_ASSERT_TRUE(vs2->isBusy());
+
+  loop(4);
+  mockInterface->feed(ack, 1);
+  mockInterface->feed(response, sizeof(response));
+  loop(2);
+
+  TEST_ASSERT_EQUAL_UINT(1, responses);
+  TEST_ASSERT_EQUAL_UINT16(0x5525, lastAddress);
+  TEST_ASSERT_TRUE(vs2->isBusy());
+
+  // second request is sent right after the ACK of the first response
+  const uint8_t expected[] = {0x41, 0x05, 0x00, 0x01, 0x55, 0x25, 0x02, 0x82,  // request 1
+                              0x06,  // ack response 1
+                              0x41, 0x05, 0x00, 0x21, 0x08, 0x10, 0x02, 0x40};  // request 2, id 1
+  loop(4);
+  TEST_ASSERT_EQUAL_UINT(sizeof(expected), mockInterface->txLength);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, mockInterface->tx, sizeof(expected));
+  TEST_ASSERT_EQUAL_UINT(0, errors);
+}
+
+void test_staleResponse() {
+  Datapoint dp("dp", 0x5525, 2, VitoWiFi::div10);
+  const uint8_t staleResponse[] = {0x41, 0x07, 0x01, 0x21, 0x55, 0x25, 0x02, 0x07, 0x01, 0xAD};  // id 1
+
+  TEST_ASSERT_TRUE(vs2->read(dp));
+  loop(4);
+  mockInterface->feed(ack, 1);
+  mockInterface->feed(staleResponse, sizeof(staleResponse));
+  loop(3);
+
+  TEST_ASSERT_EQUAL_UINT(0, responses);
+  TEST_ASSERT_TRUE(vs2->isBusy());
+
+  mockInterface->feed(response, sizeof(response));
+  loop(2);
+
+  TEST_ASSERT_EQUAL_UINT(1, responses);
+  TEST_ASSERT_FALSE(vs2->isBusy());
+  TEST_ASSERT_EQUAL_UINT(0, errors);
+}
+
+void test_runToCompletion() {
+  Datapoint dp1("dp1", 0x5525, 2, VitoWiFi::div10);
+  Datapoint dp2("dp2", 0x0810, 2, VitoWiFi::div10);
+  const uint8_t response2[] = {0x41, 0x07, 0x01, 0x21, 0x08, 0x10, 0x02, 0x07, 0x01, 0x4B};
+
+  vs2->setRunToCompletion(true);
+  vs2->read(dp1);
+  vs2->read(dp2);
+
+  vs2->loop();
+  TEST_ASSERT_EQUAL_UINT(8, mockInterface->txLength);  // request 1 sent in one call
+
+  mockInterface->feed(ack, 1);
+  mockInterface->feed(response, sizeof(response));
+  vs2->loop();
+  TEST_ASSERT_EQUAL_UINT(1, responses);
+  TEST_ASSERT_EQUAL_UINT(17, mockInterface->txLength);  // ACK + request 2 sent in the same call
+
+  mockInterface->feed(ack, 1);
+  mockInterface->feed(response2, sizeof(response2));
+  vs2->loop();
+  TEST_ASSERT_EQUAL_UINT(2, responses);
+  TEST_ASSERT_FALSE(vs2->isBusy());
+}
+
+void test_queueFull() {
+  Datapoint dp("dp", 0x5525, 2, VitoWiFi::div10);
+  for (std::size_t i = 0; i < VitoWiFi::QUEUE_SIZE; ++i) {
+    TEST_ASSERT_TRUE(vs2->read(dp));
+  }
+  TEST_ASSERT_FALSE(vs2->read(dp));
+}
+
+void test_writeLength() {
+  Datapoint dp("dp", 0x2323, 1, VitoWiFi::noconv);
+  const uint8_t data[2] = {0x01, 0x02};
+  TEST_ASSERT_FALSE(vs2->write(dp, data, 2));
+  TEST_ASSERT_TRUE(vs2->write(dp, data, 1));
+}
+
+void test_writeValue() {
+  Datapoint dp("dp", 0x5525, 2, VitoWiFi::div10);
+  TEST_ASSERT_TRUE(vs2->write(dp, VitoWiFi::VariantValue(21.5f)));
+
+  loop(4);
+  const uint8_t expected[] = {0x41, 0x07, 0x00, 0x02, 0x55, 0x25, 0x02, 0xD7, 0x00, 0x5C};
+  TEST_ASSERT_EQUAL_UINT(sizeof(expected), mockInterface->txLength);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, mockInterface->tx, sizeof(expected));
+}
+
+void test_coalesceWrites() {
+  Datapoint dp("dp", 0x5525, 2, VitoWiFi::div10);
+  TEST_ASSERT_TRUE(vs2->write(dp, VitoWiFi::VariantValue(20.0f)));
+  TEST_ASSERT_TRUE(vs2->write(dp, VitoWiFi::VariantValue(21.0f)));
+  TEST_ASSERT_TRUE(vs2->write(dp, VitoWiFi::VariantValue(21.5f)));
+  TEST_ASSERT_EQUAL_UINT32(2, vs2->queueStats(VitoWiFi::Priority::INTERACTIVE_WRITE).coalesced);
+
+  // only the last value is sent, the others complete
+  loop(4);
+  const uint8_t expected[] = {0x41, 0x07, 0x00, 0x02, 0x55, 0x25, 0x02, 0xD7, 0x00, 0x5C};
+  TEST_ASSERT_EQUAL_UINT(sizeof(expected), mockInterface->txLength);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, mockInterface->tx, sizeof(expected));
+  TEST_ASSERT_EQUAL_UINT(2, errors);
+  TEST_ASSERT_EQUAL(OptolinkResult::SUPERSEDED, lastError);
+}
+
+void test_endCancels() {
+  Datapoint sent("sent", 0x5525, 2, VitoWiFi::div10);
+  Datapoint queued("queued", 0x2323, 1, VitoWiFi::noconv);
+  Datapoint written("written", 0x2323, 1, VitoWiFi::noconv);
+
+  vs2->setRunToCompletion(true);
+  vs2->read(sent);
+  vs2->loop();
+  mockInterface->feed(ack, 1);
+  vs2->loop();
+  vs2->read(queued);
+  vs2->write(written, VitoWiFi::VariantValue(static_cast<uint8_t>(1)));
+  vs2->write(written, VitoWiFi::VariantValue(static_cast<uint8_t>(2)));
+
+  // every dropped request completes
+  vs2->end();
+  TEST_ASSERT_FALSE(vs2->isBusy());
+  TEST_ASSERT_EQUAL_UINT(4, errors);
+  VitoWiFi::LinkMetrics metrics = vs2->metrics();
+  TEST_ASSERT_EQUAL_UINT32(3, metrics.results[static_cast<std::size_t>(OptolinkResult::CANCELLED)]);
+  TEST_ASSERT_EQUAL_UINT32(1, metrics.results[static_cast<std::size_t>(OptolinkResult::SUPERSEDED)]);
+}
+
+void test_nextTimeout() {
+  Datapoint dp("dp", 0x5525, 2, VitoWiFi::div10);
+  TEST_ASSERT_EQUAL_INT(-1, vs2->fd());
+
+  // idle, keep-alive is due in 3 seconds
+  uint32_t timeout = vs2->nextTimeout();
+  TEST_ASSERT_TRUE(timeout > 2900 && timeout <= 3001);
+
+  TEST_ASSERT_TRUE(vs2->read(dp));
+  TEST_ASSERT_EQUAL_UINT32(0, vs2->nextTimeout());
+
+  // waiting for the controller, limited by the request timeout
+  loop(4);
+  timeout = vs2->nextTimeout();
+  TEST_ASSERT_TRUE(timeout > 3900 && timeout <= 4001);
+  mockInterface->feed(ack, 1);
+  TEST_ASSERT_EQUAL_UINT32(0, vs2->nextTimeout());
+}
+
+void test_retransmit() {
+  Datapoint dp("dp", 0x5525, 2, VitoWiFi::div10);
+  const uint8_t corrupted[] = {0x41, 0x07, 0x01, 0x01, 0x55, 0x25, 0x02, 0x07, 0x01, 0x8E};
+  const uint8_t nack[] = {0x15};
+
+  vs2->setRunToCompletion(true);
+  vs2->read(dp);
+  vs2->loop();
+  TEST_ASSERT_EQUAL_UINT(8, mockInterface->txLength);
+
+  // corrupted response is rejected and the same request is sent again
+  mockInterface->feed(ack, 1);
+  mockInterface->feed(corrupted, sizeof(corrupted));
+  vs2->loop();
+  TEST_ASSERT_EQUAL_UINT(0, errors);
+  TEST_ASSERT_EQUAL_UINT(17, mockInterface->txLength);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(nack, &mockInterface->tx[8], 1);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(mockInterface->tx, &mockInterface->tx[9], 8);
+
+  mockInterface->feed(ack, 1);
+  mockInterface->feed(response, sizeof(response));
+  vs2->loop();
+  TEST_ASSERT_EQUAL_UINT(1, responses);
+  TEST_ASSERT_EQUAL_UINT8(1, lastRetries);
+  TEST_ASSERT_FALSE(vs2->isBusy());
+}
+
+void test_retransmitFramingError() {
+  Datapoint dp("dp", 0x5525, 2, VitoWiFi::div10);
+  const uint8_t badLength[] = {0x41, 0x02, 0x01, 0x01, 0x55, 0x25, 0x02, 0x07, 0x01, 0x8D};
+  const uint8_t nack[] = {0x15};
+
+  vs2->setRunToCompletion(true);
+  vs2->read(dp);
+  vs2->loop();
+
+  // the rest of the frame is dropped and the request is sent again right away
+  mockInterface->feed(ack, 1);
+  mockInterface->feed(badLength, sizeof(badLength));
+  vs2->loop();
+  TEST_ASSERT_EQUAL_UINT(0, errors);
+  TEST_ASSERT_EQUAL_UINT(17, mockInterface->txLength);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(nack, &mockInterface->tx[8], 1);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(mockInterface->tx, &mockInterface->tx[9], 8);
+
+  mockInterface->feed(ack, 1);
+  mockInterface->feed(response, sizeof(response));
+  vs2->loop();
+  TEST_ASSERT_EQUAL_UINT(1, responses);
+  TEST_ASSERT_EQUAL_UINT(0, errors);
+  TEST_ASSERT_EQUAL_UINT8(1, lastRetries);
+  TEST_ASSERT_FALSE(vs2->isBusy());
+}
+
+void test_noiseBeforeResponse() {
+  Datapoint dp("dp", 0x5525, 2, VitoWiFi::div10);
+  const uint8_t noise[] = {0x41};
+
+  vs2->setRunToCompletion(true);
+  vs2->read(dp);
+  vs2->loop();
+
+  // the false start byte is rejected, the response right behind it is kept
+  mockInterface->feed(ack, 1);
+  mockInterface->feed(noise, sizeof(noise));
+  mockInterface->feed(response, sizeof(response));
+  vs2->loop();
+  vs2->loop();
+  TEST_ASSERT_EQUAL_UINT(1, responses);
+  TEST_ASSERT_EQUAL_UINT(0, errors);
+  TEST_ASSERT_EQUAL_UINT8(0, lastRetries);
+  // request and ACK, no NACK or second request
+  TEST_ASSERT_EQUAL_UINT(8 + 1, mockInterface->txLength);
+  TEST_ASSERT_EQUAL_HEX8(0x06, mockInterface->tx[8]);
+}
+
+void test_noiseBeforeAck() {
+  Datapoint dp("dp", 0x5525, 2, VitoWiFi::div10);
+  const uint8_t noise[] = {0x41, 0x00};
+
+  vs2->setRunToCompletion(true);
+  vs2->read(dp);
+  vs2->loop();
+
+  // a stray start byte before the ACK doesn't make the ACK a packet length
+  mockInterface->feed(noise, sizeof(noise));
+  mockInterface->feed(ack, 1);
+  mockInterface->feed(response, sizeof(response));
+  loop(2);
+  TEST_ASSERT_EQUAL_UINT(1, responses);
+  TEST_ASSERT_EQUAL_UINT(0, errors);
+  TEST_ASSERT_FALSE(vs2->isBusy());
+}
+
+void test_retriesExhausted() {
+  Datapoint dp("dp", 0x5525, 2, VitoWiFi::div10);
+  const uint8_t corrupted[] = {0x41, 0x07, 0x01, 0x01, 0x55, 0x25, 0x02, 0x07, 0x01, 0x8E};
+
+  vs2->setRunToCompletion(true);
+  vs2->setMaxRetries(1);
+  vs2->read(dp);
+  vs2->loop();
+  mockInterface->feed(ack, 1);
+  mockInterface->feed(corrupted, sizeof(corrupted));
+  vs2->loop();
+  mockInterface->feed(ack, 1);
+  mockInterface->feed(corrupted, sizeof(corrupted));
+  vs2->loop();
+
+  TEST_ASSERT_EQUAL_UINT(1, errors);
+  TEST_ASSERT_EQUAL(OptolinkResult::CRC, lastError);
+  TEST_ASSERT_EQUAL_UINT8(1, lastRetries);
+  TEST_ASSERT_FALSE(vs2->isBusy());
+}
+
+void test_timeoutMidResponse() {
+  Datapoint dp("dp", 0x5525, 2, VitoWiFi::div10);
+  const uint8_t nextResponse[] = {0x41, 0x07, 0x01, 0x21, 0x55, 0x25, 0x02, 0x07, 0x01, 0xAD};  // id 1
+
+  vs2->setRunToCompletion(true);
+  vs2->read(dp);
+  vs2->loop();
+  mockInterface->feed(ack, 1);
+  mockInterface->feed(response, 5);
+  vs2->loop();
+  std::this_thread::sleep_for(std::chrono::milliseconds(4100));
+  vs2->loop();
+  TEST_ASSERT_EQUAL_UINT(1, errors);
+  TEST_ASSERT_EQUAL(OptolinkResult::TIMEOUT, lastError);
+  uint32_t resyncs = vs2->metrics().resyncs;
+
+  // reconnect: EOT --> ENQ, SYNC --> ACK
+  vs2->loop();
+  mockInterface->feed(enq, 1);
+  vs2->loop();
+  mockInterface->feed(ack, 1);
+  vs2->loop();
+
+  // the ACK of the next request isn't taken for the rest of the old frame
+  vs2->read(dp);
+  vs2->loop();
+  mockInterface->feed(ack, 1);
+  mockInterface->feed(nextResponse, sizeof(nextResponse));
+  vs2->loop();
+  TEST_ASSERT_EQUAL_UINT(1, responses);
+  TEST_ASSERT_EQUAL_UINT(1, errors);
+  TEST_ASSERT_EQUAL_UINT32(resyncs, vs2->metrics().resyncs);
+  TEST_ASSERT_FALSE(vs2->isBusy());
+}
+
+void test_priority() {
+  Datapoint dp1("dp1", 0x5525, 2, VitoWiFi::div10);
+  Datapoint dp2("dp2", 0x0810, 2, VitoWiFi::div10);
+  Datapoint dp3("dp3", 0x2323, 1, VitoWiFi::noconv);
+  const uint8_t data[1] = {0x01};
+
+  vs2->setRunToCompletion(true);
+  TEST_ASSERT_TRUE(vs2->read(dp1, VitoWiFi::Priority::BACKGROUND));
+  TEST_ASSERT_TRUE(vs2->read(dp2, VitoWiFi::Priority::BACKGROUND));
+  vs2->loop();
+  TEST_ASSERT_EQUAL_UINT(8, mockInterface->txLength);
+
+  // the write overtakes the remaining background read
+  // with pipelining the second read already left the queue while the first was in flight
+  TEST_ASSERT_TRUE(vs2->write(dp3, data, 1));
+  mockInterface->feed(ack, 1);
+  mockInterface->feed(response, sizeof(response));
+  vs2->loop();
+  const uint8_t writeRequest[] = {0x06, 0x41, 0x06, 0x00, 0x22, 0x23, 0x23, 0x01, 0x01, 0x70};
+  const uint8_t readRequest[] = {0x06, 0x41, 0x05, 0x00, 0x21, 0x08, 0x10, 0x02, 0x40};
+  const bool pipelined = VitoWiFi::MAX_IN_FLIGHT > 1;
+  const uint8_t* expected = pipelined ? readRequest : writeRequest;
+  std::size_t expectedLength = pipelined ? sizeof(readRequest) : sizeof(writeRequest);
+  TEST_ASSERT_EQUAL_UINT(8 + expectedLength, mockInterface->txLength);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, &mockInterface->tx[8], expectedLength);
+
+  const VitoWiFi::QueueStats& background = vs2->queueStats(VitoWiFi::Priority::BACKGROUND);
+  TEST_ASSERT_EQUAL_UINT32(2, background.enqueued);
+  TEST_ASSERT_EQUAL_UINT32(pipelined ? 2 : 1, background.dispatched);
+  TEST_ASSERT_EQUAL_UINT8(pipelined ? 0 : 1, background.depth);
+  TEST_ASSERT_EQUAL_UINT8(2, background.maxDepth);
+  const VitoWiFi::QueueStats& writes = vs2->queueStats(VitoWiFi::Priority::INTERACTIVE_WRITE);
+  TEST_ASSERT_EQUAL_UINT32(1, writes.dispatched);
+  TEST_ASSERT_EQUAL_UINT8(0, writes.depth);
+}
+
+#if VW_MAX_IN_FLIGHT > 1
+void test_pipeline() {
+  Datapoint first("first", 0x5525, 2, VitoWiFi::div10);
+  Datapoint second("second", 0x5525, 2, VitoWiFi::div10);
+  const uint8_t response1[] = {0x41, 0x07, 0x01, 0x21, 0x55, 0x25, 0x02, 0x08, 0x01, 0xAE};
+  const char* names[2] = {nullptr, nullptr};
+  float values[2] = {0, 0};
+  vs2->onResponse([&names, &values](const PacketVS2& response, const Datapoint& request) {
+    if (responses < 2) {
+      names[responses] = request.name();
+      values[responses] = request.decode(response);
+    }
+    ++responses;
+  });
+
+  // the second request is sent once the first is acknowledged
+  vs2->setRunToCompletion(true);
+  vs2->read(first);
+  vs2->read(second);
+  vs2->loop();
+  TEST_ASSERT_EQUAL_UINT(8, mockInterface->txLength);
+  mockInterface->feed(ack, 1);
+  vs2->loop();
+  TEST_ASSERT_EQUAL_UINT(16, mockInterface->txLength);
+  TEST_ASSERT_EQUAL_HEX8(0x20, mockInterface->tx[11] & 0xE0);  // id 1
+  mockInterface->feed(ack, 1);
+  vs2->loop();
+
+  // same address, the responses are matched by id
+  mockInterface->feed(response1, sizeof(response1));
+  mockInterface->feed(response, sizeof(response));
+  loop(4);
+  TEST_ASSERT_EQUAL_UINT(2, responses);
+  TEST_ASSERT_EQUAL_UINT(0, errors);
+  TEST_ASSERT_EQUAL_STRING("second", names[0]);
+  TEST_ASSERT_EQUAL_FLOAT(26.4f, values[0]);
+  TEST_ASSERT_EQUAL_STRING("first", names[1]);
+  TEST_ASSERT_EQUAL_FLOAT(26.3f, values[1]);
+  TEST_ASSERT_FALSE(vs2->isBusy());
+}
+#endif
+
+void test_metrics() {
+  Datapoint dp("dp", 0x5525, 2, VitoWiFi::div10);
+  const uint8_t corrupted[] = {0x41, 0x07, 0x01, 0x01, 0x55, 0x25, 0x02, 0x07, 0x01, 0x8E};
+  const uint8_t noise[] = {0x00, 0x41, 0x01};
+
+  vs2->setRunToCompletion(true);
+  vs2->read(dp);
+  vs2->loop();
+  mockInterface->feed(ack, 1);
+  mockInterface->feed(corrupted, sizeof(corrupted));
+  vs2->loop();
+  mockInterface->feed(ack, 1);
+  mockInterface->feed(noise, sizeof(noise));
+  mockInterface->feed(response, sizeof(response));
+  vs2->loop();
+  TEST_ASSERT_EQUAL_UINT(1, responses);
+
+  VitoWiFi::LinkMetrics metrics = vs2->metrics();
+  TEST_ASSERT_EQUAL_UINT32(1, metrics.results[static_cast<std::size_t>(OptolinkResult::PACKET)]);
+  TEST_ASSERT_EQUAL_UINT32(0, metrics.results[static_cast<std::size_t>(OptolinkResult::CRC)]);
+  TEST_ASSERT_EQUAL_UINT32(1, metrics.resets);
+  TEST_ASSERT_EQUAL_UINT32(1, metrics.inits);
+  TEST_ASSERT_EQUAL_UINT32(0, metrics.keepAlives);
+  TEST_ASSERT_EQUAL_UINT32(1, metrics.checksumErrors);
+  // 0x00 skipped, invalid length and 0x01 skipped
+  TEST_ASSERT_EQUAL_UINT32(2, metrics.resyncs);
+  // EOT + SYNC, request, NACK, request, ACK
+  TEST_ASSERT_EQUAL_UINT32(4 + 8 + 1 + 8 + 1, metrics.bytesSent);
+  // ENQ + ACK, ACK + corrupted response, ACK + noise + response
+  TEST_ASSERT_EQUAL_UINT32(2 + 11 + 14, metrics.bytesReceived);
+}
+
+void test_latency() {
+  Datapoint dp("dp", 0x5525, 2, VitoWiFi::div10);
+  const uint8_t corrupted[] = {0x41, 0x07, 0x01, 0x01, 0x55, 0x25, 0x02, 0x07, 0x01, 0x8E};
+  VitoWiFi::LatencyHistograms<2> latencies;
+
+  vs2->setLatencyRecorder(&latencies);
+  vs2->setRunToCompletion(true);
+  vs2->setMaxRetries(0);
+  vs2->read(dp);
+  vs2->loop();
+  mockInterface->feed(ack, 1);
+  mockInterface->feed(response, sizeof(response));
+  vs2->loop();
+  vs2->read(dp);
+  vs2->loop();
+  mockInterface->feed(ack, 1);
+  mockInterface->feed(corrupted, sizeof(corrupted));
+  vs2->loop();
+
+  TEST_ASSERT_EQUAL_UINT(1, responses);
+  TEST_ASSERT_EQUAL_UINT(1, errors);
+  TEST_ASSERT_EQUAL_UINT(1, latencies.size());
+  TEST_ASSERT_EQUAL_UINT16(0x5525, latencies.address(0));
+  TEST_ASSERT_EQUAL_UINT32(1, latencies.errors(0x5525));
+  TEST_ASSERT_NULL(latencies.histogram(0x0810, VitoWiFi::LatencyPhase::TOTAL));
+  // the failed request has no complete response
+  TEST_ASSERT_EQUAL_UINT32(2, latencies.histogram(0x5525, VitoWiFi::LatencyPhase::QUEUE)->count);
+  TEST_ASSERT_EQUAL_UINT32(2, latencies.histogram(0x5525, VitoWiFi::LatencyPhase::SEND)->count);
+  TEST_ASSERT_EQUAL_UINT32(1, latencies.histogram(0x5525, VitoWiFi::LatencyPhase::RESPONSE)->count);
+  TEST_ASSERT_EQUAL_UINT32(1, latencies.histogram(0x5525, VitoWiFi::LatencyPhase::RECEIVE)->count);
+  TEST_ASSERT_EQUAL_UINT32(2, latencies.histogram(0x5525, VitoWiFi::LatencyPhase::TOTAL)->count);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_queueRequests);
+  RUN_TEST(test_staleResponse);
+  RUN_TEST(test_runToCompletion);
+  RUN_TEST(test_queueFull);
+  RUN_TEST(test_writeLength);
+  RUN_TEST(test_writeValue);
+  RUN_TEST(test_coalesceWrites);
+  RUN_TEST(test_endCancels);
+  RUN_TEST(test_nextTimeout);
+  RUN_TEST(test_retransmit);
+  RUN_TEST(test_retransmitFramingError);
+  RUN_TEST(test_noiseBeforeResponse);
+  RUN_TEST(test_noiseBeforeAck);
+  RUN_TEST(test_retriesExhausted);
+  RUN_TEST(test_timeoutMidResponse);
+  RUN_TEST(test_priority);
+#if VW_MAX_IN_FLIGHT > 1
+  RUN_TEST(test_pipeline);
+#endif
+  RUN_TEST(test_metrics);
+  RUN_TEST(test_latency);
+  return UNITY_END();
+}
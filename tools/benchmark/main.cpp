@@ -0,0 +1,323 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+/*
+End-to-end benchmark: runs VS2, VS1 and GWG against the emulator in
+tools/emulator and reports throughput, read latency, bus utilization and
+CPU time per transaction. Results are also written as JSON so runs of
+different releases can be compared.
+*/
+
+#include <poll.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT [build/c++11]
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>  // NOLINT [build/c++11]
+#include <thread>  // NOLINT [build/c++11]
+#include <vector>
+
+#include <VitoWiFi.h>
+
+#include "Emulator.h"
+
+// 1 start bit, 8 data bits, parity and 2 stop bits
+constexpr double BITS_PER_BYTE = 12;
+constexpr double BAUD = 4800;
+
+struct Options {
+  Options()
+  : count(100)
+  , seconds(30)
+  , depth(1)
+  , length(2)
+  , emulator()
+  , output("benchmark.json")
+  , label("") {
+    // empty
+  }
+  uint32_t count;  // measured transactions per protocol
+  uint32_t seconds;  // upper limit per protocol
+  uint32_t depth;  // outstanding requests
+  uint8_t length;  // bytes per read
+  VitoWiFiEmulator::Config emulator;
+  const char* output;
+  const char* label;
+};
+
+struct Result {
+  const char* protocol;
+  uint32_t transactions;
+  uint32_t errors;
+  double duration;  // s
+  double p50;  // ms
+  double p99;  // ms
+  double wireTime;  // s the bytes take on a 4800 baud line
+  double cpuTime;  // s
+  uint32_t bytes;
+};
+
+uint64_t now() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double cpuTime() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+double percentile(std::vector<uint32_t>* latencies, double p) {
+  if (latencies->empty()) return 0;
+  std::size_t index = static_cast<std::size_t>(p * (latencies->size() - 1) + 0.5);
+  std::nth_element(latencies->begin(), latencies->begin() + index, latencies->end());
+  return (*latencies)[index] / 1000.0;
+}
+
+// Runs the emulator in its own thread and keeps a copy of its statistics.
+class EmulatorThread {
+ public:
+  explicit EmulatorThread(const VitoWiFiEmulator::Config& config)
+  : _emulator(config)
+  , _stop(false)
+  , _thread()
+  , _mutex()
+  , _stats() {
+    const uint8_t data[16] = {0x20, 0xB8, 0x07, 0x01, 0x00, 0x01, 0x02, 0x03,
+                              0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B};
+    _emulator.set(0x00F8, data, sizeof(data));
+  }
+  ~EmulatorThread() {
+    _stop = true;
+    if (_thread.joinable()) _thread.join();
+  }
+
+  bool begin() {
+    if (!_emulator.begin()) return false;
+    _thread = std::thread([this]() {
+      while (!_stop) {
+        _emulator.loop(10);
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stats = _emulator.stats();
+      }
+    });
+    return true;
+  }
+
+  const char* devicePath() const {
+    return _emulator.devicePath();
+  }
+
+  uint32_t bytes() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats.bytesReceived + _stats.bytesSent;
+  }
+
+ private:
+  VitoWiFiEmulator::Emulator _emulator;
+  std::atomic<bool> _stop;
+  std::thread _thread;
+  std::mutex _mutex;
+  VitoWiFiEmulator::Stats _stats;
+};
+
+template <class PROTOCOLVERSION>
+class Client {
+ public:
+  explicit Client(const char* device)
+  : _vitoWiFi(device)
+  , _datapoint("benchmark", 0x00F8, 2, VitoWiFi::noconv)
+  , _submitted()
+  , _latencies()
+  , _errors(0) {
+    _vitoWiFi.onResponse(ResponseHandler{this});
+    _vitoWiFi.onError([this](VitoWiFi::OptolinkResult, const VitoWiFi::Datapoint&) {
+      ++_errors;
+      _done();
+    });
+  }
+
+  // The first transaction connects and isn't measured.
+  bool run(const Options& options, EmulatorThread* emulator, Result* result) {
+    _datapoint = VitoWiFi::Datapoint("benchmark", 0x00F8, options.length, VitoWiFi::noconv);
+    if (!_vitoWiFi.begin()) return false;
+    uint64_t deadline = now() + options.seconds * 1000000ULL;
+    _transact(1, 1, deadline);
+    _latencies.clear();
+    _errors = 0;
+
+    uint32_t bytes = emulator->bytes();
+    double cpu = cpuTime();
+    uint64_t start = now();
+    _transact(options.count, options.depth, deadline);
+    result->duration = (now() - start) / 1e6;
+    result->cpuTime = cpuTime() - cpu;
+    result->bytes = emulator->bytes() - bytes;
+    result->wireTime = result->bytes * BITS_PER_BYTE / BAUD;
+    result->errors = _errors;
+    result->transactions = _latencies.size();
+    result->p50 = percentile(&_latencies, 0.5);
+    result->p99 = percentile(&_latencies, 0.99);
+    _vitoWiFi.end();
+    return true;
+  }
+
+ private:
+  struct ResponseHandler {
+    Client* client;
+    void operator()(const VitoWiFi::PacketVS2&, const VitoWiFi::Datapoint&) const {
+      client->_latencies.push_back(now() - client->_submitted.front());
+      client->_done();
+    }
+    void operator()(const uint8_t*, uint8_t, const VitoWiFi::Datapoint&) const {
+      client->_latencies.push_back(now() - client->_submitted.front());
+      client->_done();
+    }
+  };
+
+  VitoWiFi::VitoWiFi<PROTOCOLVERSION> _vitoWiFi;
+  VitoWiFi::Datapoint _datapoint;
+  std::deque<uint64_t> _submitted;
+  std::vector<uint32_t> _latencies;  // us
+  uint32_t _errors;
+
+  void _done() {
+    if (!_submitted.empty()) _submitted.pop_front();
+  }
+
+  // keeps depth reads outstanding until count transactions are done
+  void _transact(uint32_t count, uint32_t depth, uint64_t deadline) {
+    uint32_t submitted = 0;
+    while ((_latencies.size() + _errors < count || !_submitted.empty()) && now() < deadline) {
+      while (submitted < count && _submitted.size() < depth && _vitoWiFi.read(_datapoint)) {
+        _submitted.push_back(now());
+        ++submitted;
+      }
+      struct pollfd pfd = {_vitoWiFi.fd(), POLLIN, 0};
+      poll(&pfd, 1, std::min<uint32_t>(_vitoWiFi.nextTimeout(), 100));
+      _vitoWiFi.loop();
+    }
+  }
+};
+
+template <class PROTOCOLVERSION>
+bool benchmark(const char* name, VitoWiFiEmulator::Protocol protocol, Options options, Result* result) {
+  options.emulator.protocol = protocol;
+  EmulatorThread emulator(options.emulator);
+  if (!emulator.begin()) return false;
+  Client<PROTOCOLVERSION> client(emulator.devicePath());
+  result->protocol = name;
+  return client.run(options, &emulator, result);
+}
+
+void print(const Result& result) {
+  double txPerSecond = result.duration > 0 ? result.transactions / result.duration : 0;
+  printf("%-4s %6u tx %4u err %8.2f tx/s  p50 %7.1f ms  p99 %7.1f ms  bus %5.1f %%  cpu %7.1f us/tx\n",
+         result.protocol, result.transactions, result.errors, txPerSecond, result.p50, result.p99,
+         result.duration > 0 ? 100 * result.wireTime / result.duration : 0,
+         result.transactions > 0 ? 1e6 * result.cpuTime / result.transactions : 0);
+}
+
+bool write(const Options& options, const Result* results, std::size_t count) {
+  FILE* file = fopen(options.output, "w");
+  if (!file) {
+    perror("Could not open output file");
+    return false;
+  }
+  fprintf(file, "{\n  \"label\": \"%s\",\n  \"config\": {\"count\": %u, \"depth\": %u, \"length\": %u, "
+                "\"responseDelayMs\": %u, \"enqIntervalMs\": %u, \"byteTiming\": %s},\n  \"results\": [\n",
+          options.label, options.count, options.depth, options.length, options.emulator.responseDelay,
+          options.emulator.enqInterval, options.emulator.byteTiming ? "true" : "false");
+  for (std::size_t i = 0; i < count; ++i) {
+    const Result& r = results[i];
+    fprintf(file, "    {\"protocol\": \"%s\", \"transactions\": %u, \"errors\": %u, \"durationS\": %.3f, "
+                  "\"txPerS\": %.3f, \"p50Ms\": %.2f, \"p99Ms\": %.2f, \"wireBytes\": %u, \"busUtilization\": %.4f, "
+                  "\"cpuUsPerTx\": %.2f}%s\n",
+            r.protocol, r.transactions, r.errors, r.duration,
+            r.duration > 0 ? r.transactions / r.duration : 0, r.p50, r.p99, r.bytes,
+            r.duration > 0 ? r.wireTime / r.duration : 0,
+            r.transactions > 0 ? 1e6 * r.cpuTime / r.transactions : 0,
+            i + 1 < count ? "," : "");
+  }
+  fprintf(file, "  ]\n}\n");
+  fclose(file);
+  return true;
+}
+
+void usage(const char* name) {
+  printf("usage: %s [options]\n"
+         "  --protocol vs1|vs2|gwg|all  protocols to run (default all)\n"
+         "  --count N                   measured transactions per protocol (default 100)\n"
+         "  --seconds N                 time limit per protocol (default 30)\n"
+         "  --depth N                   outstanding requests (default 1)\n"
+         "  --length N                  bytes per read (default 2)\n"
+         "  --delay MS                  emulator response delay (default 20)\n"
+         "  --enq MS                    emulator ENQ interval (default 2000)\n"
+         "  --no-timing                 don't emulate 4800 baud\n"
+         "  --output FILE               results file (default benchmark.json)\n"
+         "  --label TEXT                stored in the results file, eg. the release\n",
+         name);
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  const char* protocols = "all";
+  for (int i = 1; i < argc; ++i) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--protocol") == 0 && hasValue) {
+      protocols = argv[++i];
+    } else if (strcmp(argv[i], "--count") == 0 && hasValue) {
+      options.count = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--seconds") == 0 && hasValue) {
+      options.seconds = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--depth") == 0 && hasValue) {
+      options.depth = std::max<uint32_t>(1, strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--length") == 0 && hasValue) {
+      options.length = std::min<uint32_t>(16, std::max<uint32_t>(1, strtoul(argv[++i], nullptr, 10)));
+    } else if (strcmp(argv[i], "--delay") == 0 && hasValue) {
+      options.emulator.responseDelay = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--enq") == 0 && hasValue) {
+      options.emulator.enqInterval = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--no-timing") == 0) {
+      options.emulator.byteTiming = false;
+    } else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+      options.output = argv[++i];
+    } else if (strcmp(argv[i], "--label") == 0 && hasValue) {
+      options.label = argv[++i];
+    } else {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  bool all = strcmp(protocols, "all") == 0;
+
+  Result results[3];
+  std::size_t count = 0;
+  if (all || strcmp(protocols, "vs2") == 0) {
+    if (!benchmark<VitoWiFi::VS2>("VS2", VitoWiFiEmulator::Protocol::VS2, options, &results[count])) return EXIT_FAILURE;
+    print(results[count++]);
+  }
+  if (all || strcmp(protocols, "vs1") == 0) {
+    if (!benchmark<VitoWiFi::VS1>("VS1", VitoWiFiEmulator::Protocol::VS1, options, &results[count])) return EXIT_FAILURE;
+    print(results[count++]);
+  }
+  if (all || strcmp(protocols, "gwg") == 0) {
+    if (!benchmark<VitoWiFi::GWG>("GWG", VitoWiFiEmulator::Protocol::GWG, options, &results[count])) return EXIT_FAILURE;
+    print(results[count++]);
+  }
+  if (count == 0) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  return write(options, results, count) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
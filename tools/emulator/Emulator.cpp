@@ -0,0 +1,347 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#include "Emulator.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <chrono>  // NOLINT [build/c++11]
+#include <cstdio>
+#include <cstring>
+
+namespace VitoWiFiEmulator {
+
+Emulator::Emulator(const Config& config)
+: _config(config)
+, _master(-1)
+, _slave(-1)
+, _devicePath()
+, _memory()
+, _stats()
+, _rx()
+, _tx()
+, _lastRx(0)
+, _lastTx(0)
+, _nextEnq(0)
+, _connected(false)
+, _syncLength(0)
+, _parser()
+, _frame()
+, _frameLength(0)
+, _response()
+, _responses(0)
+, _request()
+, _requestLength(0)
+, _addressed(false)
+, _windowEnd(0) {
+  // empty
+}
+
+Emulator::~Emulator() {
+  end();
+}
+
+bool Emulator::begin() {
+  _master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (_master < 0 || grantpt(_master) != 0 || unlockpt(_master) != 0) {
+    perror("Could not create pseudo terminal");
+    return false;
+  }
+  const char* name = ptsname(_master);
+  if (!name) {
+    perror("Could not get pseudo terminal name");
+    return false;
+  }
+  snprintf(_devicePath, sizeof(_devicePath), "%s", name);
+
+  // raw mode, without echo the client doesn't read its own bytes back
+  _slave = open(_devicePath, O_RDWR | O_NOCTTY);
+  if (_slave < 0) {
+    perror("Could not open pseudo terminal");
+    return false;
+  }
+  struct termios tty;
+  if (tcgetattr(_slave, &tty) != 0) {
+    perror("Could not configure pseudo terminal");
+    return false;
+  }
+  cfmakeraw(&tty);
+  if (tcsetattr(_slave, TCSANOW, &tty) != 0) {
+    perror("Could not configure pseudo terminal");
+    return false;
+  }
+  _nextEnq = _now();
+  return true;
+}
+
+void Emulator::end() {
+  if (_slave >= 0) close(_slave);
+  if (_master >= 0) close(_master);
+  _slave = -1;
+  _master = -1;
+}
+
+const char* Emulator::devicePath() const {
+  return _devicePath;
+}
+
+void Emulator::set(uint16_t address, const uint8_t* data, std::size_t length) {
+  for (std::size_t i = 0; i < length; ++i) {
+    _memory[(address + i) & 0xFFFF] = data[i];
+  }
+}
+
+const uint8_t* Emulator::get(uint16_t address) const {
+  return &_memory[address];
+}
+
+void Emulator::loop(uint32_t maxWait) {
+  uint64_t now = _now();
+  uint64_t wakeup = now + maxWait * 1000ULL;
+  if (!_rx.empty() && _rx.front().time < wakeup) wakeup = _rx.front().time;
+  if (!_tx.empty() && _tx.front().time < wakeup) wakeup = _tx.front().time;
+  bool waitingForClient = (_config.protocol == Protocol::VS2) ? !_connected : _requestLength == 0;
+  if (waitingForClient && _tx.empty() && _nextEnq < wakeup) wakeup = _nextEnq;
+
+  int timeout = (wakeup > now) ? static_cast<int>((wakeup - now + 999) / 1000) : 0;
+  struct pollfd pfd = {_master, POLLIN, 0};
+  poll(&pfd, 1, timeout);
+
+  _receive();
+  _transmit();
+  _enq();
+}
+
+const Stats& Emulator::stats() const {
+  return _stats;
+}
+
+uint64_t Emulator::_now() const {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 1 start bit, 8 data bits, parity and 2 stop bits at 4800 baud
+uint64_t Emulator::_byteTime() const {
+  return _config.byteTiming ? 12 * 1000000ULL / 4800 : 0;
+}
+
+// bytes reach the controller one byte time after each other
+void Emulator::_receive() {
+  uint8_t buffer[256];
+  ssize_t length = 0;
+  uint64_t now = _now();
+  while ((length = ::read(_master, buffer, sizeof(buffer))) > 0) {
+    for (ssize_t i = 0; i < length; ++i) {
+      uint64_t arrival = _lastRx + _byteTime();
+      if (arrival < now) arrival = now;
+      _rx.push_back({buffer[i], arrival});
+      _lastRx = arrival;
+    }
+    _stats.bytesReceived += length;
+  }
+  while (!_rx.empty() && _rx.front().time <= now) {
+    TimedByte b = _rx.front();
+    _rx.pop_front();
+    _handle(b.value, b.time);
+  }
+}
+
+void Emulator::_transmit() {
+  uint8_t buffer[256];
+  std::size_t length = 0;
+  uint64_t now = _now();
+  while (!_tx.empty() && _tx.front().time <= now && length < sizeof(buffer)) {
+    buffer[length++] = _tx.front().value;
+    _tx.pop_front();
+  }
+  if (length > 0 && ::write(_master, buffer, length) == static_cast<ssize_t>(length)) {
+    _stats.bytesSent += length;
+  }
+}
+
+void Emulator::_send(const uint8_t* data, std::size_t length, uint64_t notBefore) {
+  for (std::size_t i = 0; i < length; ++i) {
+    uint64_t time = _lastTx + _byteTime();
+    if (time < notBefore) time = notBefore;
+    _tx.push_back({data[i], time});
+    _lastTx = time;
+  }
+}
+
+void Emulator::_handle(uint8_t b, uint64_t time) {
+  switch (_config.protocol) {
+  case Protocol::VS2:
+    _handleVS2(b, time);
+    break;
+  case Protocol::VS1:
+    _handleVS1(b, time);
+    break;
+  case Protocol::GWG:
+    _handleGWG(b, time);
+    break;
+  }
+}
+
+void Emulator::_handleVS2(uint8_t b, uint64_t time) {
+  if (_parser.isIdle()) {
+    if (b == VitoWiFiInternals::ProtocolBytes.EOT) {
+      ++_stats.resets;
+      _connected = false;
+      _syncLength = 0;
+      _nextEnq = time;
+      return;
+    }
+    // SYNC starts or keeps the connection
+    if (_syncLength < sizeof(VitoWiFiInternals::ProtocolBytes.SYNC) &&
+        b == VitoWiFiInternals::ProtocolBytes.SYNC[_syncLength]) {
+      if (++_syncLength == sizeof(VitoWiFiInternals::ProtocolBytes.SYNC)) {
+        _syncLength = 0;
+        _connected = true;
+        _send(&VitoWiFiInternals::ProtocolBytes.ACK, 1, time);
+      }
+      return;
+    }
+    _syncLength = 0;
+    // the client acknowledges our response
+    if (b == VitoWiFiInternals::ProtocolBytes.ACK || b == VitoWiFiInternals::ProtocolBytes.NACK) return;
+    if (!_connected) return;
+    if (b == VitoWiFiInternals::ProtocolBytes.PACKETSTART) _frameLength = 0;
+  }
+  if (_frameLength < sizeof(_frame)) _frame[_frameLength++] = b;
+  VitoWiFiInternals::ParserResult result = _parser.parse(b);
+  if (result == VitoWiFiInternals::ParserResult::COMPLETE) {
+    _send(&VitoWiFiInternals::ProtocolBytes.ACK, 1, time);
+    _answerVS2(time);
+  } else if (result == VitoWiFiInternals::ParserResult::CS_ERROR) {
+    ++_stats.checksumErrors;
+    _send(&VitoWiFiInternals::ProtocolBytes.NACK, 1, time);
+  }
+}
+
+void Emulator::_answerVS2(uint64_t time) {
+  const VitoWiFi::PacketVS2& request = _parser.packet();
+  uint16_t address = request.address();
+  uint8_t length = request.dataLength();
+  bool created = false;
+  if (request.functionCode() == VitoWiFi::FunctionCode::READ) {
+    ++_stats.reads;
+    uint8_t data[256];
+    for (std::size_t i = 0; i < length; ++i) {
+      data[i] = _memory[(address + i) & 0xFFFF];
+    }
+    created = _response.createPacket(VitoWiFi::PacketType::RESPONSE, VitoWiFi::FunctionCode::READ, request.id(), address, length, data);
+  } else if (request.functionCode() == VitoWiFi::FunctionCode::WRITE) {
+    ++_stats.writes;
+    // payload sits between the header and the checksum
+    set(address, &_frame[_frameLength - 1 - length], length);
+    created = _response.createPacket(VitoWiFi::PacketType::RESPONSE, VitoWiFi::FunctionCode::WRITE, request.id(), address, length);
+  }
+  if (!created) return;  // remote procedure calls aren't supported
+
+  uint8_t frame[256 + 2];
+  std::size_t frameLength = 0;
+  frame[frameLength++] = VitoWiFiInternals::ProtocolBytes.PACKETSTART;
+  for (std::size_t i = 0; i < _response.length(); ++i) {
+    frame[frameLength++] = _response[i];
+  }
+  uint8_t checksum = _response.checksum();
+  if (_config.corruptEvery > 0 && ++_responses % _config.corruptEvery == 0) {
+    ++checksum;
+    ++_stats.corrupted;
+  }
+  frame[frameLength++] = checksum;
+  _send(frame, frameLength, time + _config.responseDelay * 1000ULL);
+}
+
+/*
+Requests follow on 0x01, the answer to an ENQ. Right after a response
+the client may also send the next request without waiting for an ENQ.
+*/
+void Emulator::_handleVS1(uint8_t b, uint64_t time) {
+  if (_requestLength == 0) {
+    if (b == VitoWiFiInternals::ProtocolBytes.ENQ_ACK) {
+      _addressed = true;
+      return;
+    }
+    if (b == VitoWiFiInternals::ProtocolBytes.EOT) {
+      ++_stats.resets;
+      _addressed = false;
+      _nextEnq = time;
+      return;
+    }
+    if (!_addressed && time > _windowEnd) return;
+  }
+  _request[_requestLength++] = b;
+  uint8_t type = _request[0];
+  if (type != VitoWiFi::PacketVS1Type.READ && type != VitoWiFi::PacketVS1Type.WRITE) {
+    _requestLength = 0;
+    return;
+  }
+  if (_requestLength < 4) return;
+  bool write = type == VitoWiFi::PacketVS1Type.WRITE;
+  if (_requestLength < (write ? 4U + _request[3] : 4U)) return;
+  _addressed = false;
+  _requestLength = 0;
+  _answerKW(write, (_request[1] << 8) | _request[2], _request[3], &_request[4], time);
+  _windowEnd = _lastTx + 50000;
+}
+
+// requests are framed by 0x01 and EOT
+void Emulator::_handleGWG(uint8_t b, uint64_t time) {
+  if (_requestLength == 0 && b != VitoWiFiInternals::ProtocolBytes.ENQ_ACK) return;
+  _request[_requestLength++] = b;
+  if (_requestLength < 2) return;
+  uint8_t type = _request[1];
+  if (type != VitoWiFi::PacketGWGType.READ && type != VitoWiFi::PacketGWGType.WRITE) {
+    _requestLength = 0;
+    return;
+  }
+  if (_requestLength < 5) return;
+  bool write = type == VitoWiFi::PacketGWGType.WRITE;
+  if (_requestLength < (write ? 5U + _request[3] : 5U)) return;
+  _requestLength = 0;
+  if (b != VitoWiFiInternals::ProtocolBytes.EOT) return;
+  _answerKW(write, _request[2], _request[3], &_request[4], time);
+}
+
+// reads are answered with the data, writes with a single 0x00 like the controller does
+void Emulator::_answerKW(bool write, uint16_t address, uint8_t length, const uint8_t* data, uint64_t time) {
+  uint64_t notBefore = time + _config.responseDelay * 1000ULL;
+  if (write) {
+    ++_stats.writes;
+    set(address, data, length);
+    const uint8_t ok = 0x00;
+    _send(&ok, 1, notBefore);
+  } else {
+    ++_stats.reads;
+    uint8_t response[256];
+    for (std::size_t i = 0; i < length; ++i) {
+      response[i] = _memory[(address + i) & 0xFFFF];
+    }
+    _send(response, length, notBefore);
+  }
+  _nextEnq = _lastTx + _config.enqInterval * 1000ULL;
+}
+
+// periodic ENQ while nobody is talking to the controller
+void Emulator::_enq() {
+  uint64_t now = _now();
+  bool waitingForClient = (_config.protocol == Protocol::VS2) ? !_connected : _requestLength == 0;
+  if (!waitingForClient || !_tx.empty() || now < _nextEnq) return;
+  if (_config.protocol == Protocol::VS1 && (_addressed || now <= _windowEnd)) return;
+  // on a real line, ENQs are lost when nobody listens; here they would pile up in the terminal
+  tcflush(_slave, TCIFLUSH);
+  _send(&VitoWiFiInternals::ProtocolBytes.ENQ, 1, now);
+  _nextEnq = now + _config.enqInterval * 1000ULL;
+}
+
+}  // end namespace VitoWiFiEmulator
@@ -0,0 +1,133 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+
+#include <VS2/ParserVS2.h>
+
+namespace VitoWiFiEmulator {
+
+enum class Protocol {
+  VS1,
+  VS2,
+  GWG
+};
+
+struct Config {
+  Config()
+  : protocol(Protocol::VS2)
+  , enqInterval(2000)
+  , responseDelay(20)
+  , byteTiming(true)
+  , corruptEvery(0) {
+    // empty
+  }
+  Protocol protocol;
+  uint32_t enqInterval;  // ms between ENQs while waiting for a client
+  uint32_t responseDelay;  // ms between the end of a request and the start of the response
+  bool byteTiming;  // 4800 baud 8E2: every byte takes 2.5 ms on the line
+  uint32_t corruptEvery;  // VS2: every nth response gets a wrong checksum, 0 = never
+};
+
+struct Stats {
+  Stats()
+  : reads(0)
+  , writes(0)
+  , checksumErrors(0)
+  , corrupted(0)
+  , resets(0)
+  , bytesReceived(0)
+  , bytesSent(0) {
+    // empty
+  }
+  uint32_t reads;
+  uint32_t writes;
+  uint32_t checksumErrors;  // requests that were answered with NACK
+  uint32_t corrupted;  // responses sent with a wrong checksum
+  uint32_t resets;  // EOTs received
+  uint32_t bytesReceived;
+  uint32_t bytesSent;
+};
+
+/*
+Controller side of the Optolink protocols on a pseudo terminal. Clients
+open devicePath() like a serial adapter. The emulator serves reads and
+writes from a 64k address space.
+Bytes are passed on at the pace of a 4800 baud line in both directions.
+*/
+class Emulator {
+ public:
+  explicit Emulator(const Config& config);
+  ~Emulator();
+  Emulator(const Emulator&) = delete;
+  Emulator & operator=(const Emulator&) = delete;
+
+  // Creates the pseudo terminal. Returns false on error.
+  bool begin();
+  void end();
+  const char* devicePath() const;
+
+  void set(uint16_t address, const uint8_t* data, std::size_t length);
+  const uint8_t* get(uint16_t address) const;
+
+  // Waits at most maxWait ms for input or timed output and handles it.
+  void loop(uint32_t maxWait);
+  const Stats& stats() const;
+
+ private:
+  struct TimedByte {
+    uint8_t value;
+    uint64_t time;  // us
+  };
+
+  Config _config;
+  int _master;
+  int _slave;  // kept open so the terminal stays configured when the client closes it
+  char _devicePath[64];
+  uint8_t _memory[65536];
+  Stats _stats;
+
+  std::deque<TimedByte> _rx;  // received, handled at the time the byte would have arrived
+  std::deque<TimedByte> _tx;  // to send, written at the time the byte goes out
+  uint64_t _lastRx;
+  uint64_t _lastTx;
+  uint64_t _nextEnq;
+
+  // VS2
+  bool _connected;
+  uint8_t _syncLength;
+  VitoWiFiInternals::ParserVS2 _parser;
+  uint8_t _frame[256 + 2];  // raw bytes of the request being parsed
+  std::size_t _frameLength;
+  VitoWiFiInternals::EnginePacketVS2 _response;
+  uint32_t _responses;
+  // VS1 and GWG
+  uint8_t _request[256 + 6];
+  std::size_t _requestLength;
+  bool _addressed;  // VS1: ENQ_ACK received
+  uint64_t _windowEnd;  // VS1: a next request may follow a response without ENQ until then
+
+  uint64_t _now() const;
+  uint64_t _byteTime() const;
+  void _receive();
+  void _transmit();
+  void _send(const uint8_t* data, std::size_t length, uint64_t notBefore);
+  void _handle(uint8_t b, uint64_t time);
+  void _handleVS2(uint8_t b, uint64_t time);
+  void _handleVS1(uint8_t b, uint64_t time);
+  void _handleGWG(uint8_t b, uint64_t time);
+  void _answerVS2(uint64_t time);
+  void _answerKW(bool write, uint16_t address, uint8_t length, const uint8_t* data, uint64_t time);
+  void _enq();
+};
+
+}  // end namespace VitoWiFiEmulator
@@ -0,0 +1,133 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+/*
+Emulates a Vitotronic controller on a pseudo terminal so VitoWiFi can be
+run without hardware:
+
+  emulator --protocol vs2 --link /tmp/optolink
+  (in another terminal) point VitoWiFi to /tmp/optolink
+*/
+
+#include <signal.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Emulator.h"
+
+volatile sig_atomic_t quit = 0;
+
+void signalHandler(int) {
+  quit = 1;
+}
+
+void usage(const char* name) {
+  printf("usage: %s [options]\n"
+         "  --protocol vs1|vs2|gwg  protocol to emulate (default vs2)\n"
+         "  --delay MS              response delay (default 20)\n"
+         "  --enq MS                interval between ENQs (default 2000)\n"
+         "  --no-timing             don't emulate 4800 baud\n"
+         "  --corrupt N             corrupt the checksum of every Nth VS2 response\n"
+         "  --set ADDR=HEX          preset memory, eg. --set 00F8=20B8\n"
+         "  --link PATH             create a symlink to the pseudo terminal\n",
+         name);
+}
+
+bool parseSet(const char* arg, VitoWiFiEmulator::Emulator* emulator) {
+  char* end = nullptr;
+  unsigned long address = strtoul(arg, &end, 16);  // NOLINT [runtime/int]
+  if (*end != '=' || address > 0xFFFF) return false;
+  const char* hex = end + 1;
+  uint8_t data[256];
+  std::size_t length = 0;
+  while (hex[0] && hex[1] && length < sizeof(data)) {
+    char byte[3] = {hex[0], hex[1], 0};
+    data[length++] = strtoul(byte, &end, 16);
+    if (*end) return false;
+    hex += 2;
+  }
+  if (*hex || length == 0) return false;
+  emulator->set(address, data, length);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  VitoWiFiEmulator::Config config;
+  const char* link = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--protocol") == 0 && hasValue) {
+      const char* protocol = argv[++i];
+      if (strcmp(protocol, "vs1") == 0) {
+        config.protocol = VitoWiFiEmulator::Protocol::VS1;
+      } else if (strcmp(protocol, "vs2") == 0) {
+        config.protocol = VitoWiFiEmulator::Protocol::VS2;
+      } else if (strcmp(protocol, "gwg") == 0) {
+        config.protocol = VitoWiFiEmulator::Protocol::GWG;
+      } else {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+    } else if (strcmp(argv[i], "--delay") == 0 && hasValue) {
+      config.responseDelay = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--enq") == 0 && hasValue) {
+      config.enqInterval = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--no-timing") == 0) {
+      config.byteTiming = false;
+    } else if (strcmp(argv[i], "--corrupt") == 0 && hasValue) {
+      config.corruptEvery = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--link") == 0 && hasValue) {
+      link = argv[++i];
+    } else if (strcmp(argv[i], "--set") != 0) {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    } else {
+      ++i;  // handled once the emulator exists
+    }
+  }
+
+  VitoWiFiEmulator::Emulator emulator(config);
+  const uint8_t outsideTemp[] = {0x20, 0xB8};
+  const uint8_t hotWaterTemp[] = {0x07, 0x01};
+  emulator.set(0x00F8, outsideTemp, sizeof(outsideTemp));
+  emulator.set(0x5525, hotWaterTemp, sizeof(hotWaterTemp));
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--set") != 0) continue;
+    if (i + 1 >= argc || !parseSet(argv[++i], &emulator)) {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (!emulator.begin()) return EXIT_FAILURE;
+  if (link) {
+    unlink(link);
+    if (symlink(emulator.devicePath(), link) != 0) {
+      perror("Could not create link");
+      return EXIT_FAILURE;
+    }
+  }
+  printf("Emulating on %s\n", link ? link : emulator.devicePath());
+  fflush(stdout);
+
+  signal(SIGINT, signalHandler);
+  signal(SIGTERM, signalHandler);
+  while (!quit) {
+    emulator.loop(100);
+  }
+
+  if (link) unlink(link);
+  const VitoWiFiEmulator::Stats& stats = emulator.stats();
+  printf("reads: %u, writes: %u, checksum errors: %u, corrupted: %u, resets: %u, rx: %u bytes, tx: %u bytes\n",
+         stats.reads, stats.writes, stats.checksumErrors, stats.corrupted, stats.resets,
+         stats.bytesReceived, stats.bytesSent);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,277 @@
+/*
+Copyright (c) 2023 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.  
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+/*
+Microbenchmarks for the CPU bound parts of the library: packet creation,
+parsing of VS2 byte streams, the converters and the schedule helpers.
+Reports ns/op and allocations/op. Allocations are counted by wrapping
+glibc's malloc family, which also catches operator new.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <chrono>  // NOLINT [build/c++11]
+#include <vector>
+
+#include <VitoWiFi.h>
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void __libc_free(void* ptr);
+}
+
+static uint64_t allocations = 0;
+
+extern "C" {
+void* malloc(size_t size) noexcept {
+  ++allocations;
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept {
+  ++allocations;
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) noexcept {
+  ++allocations;
+  return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr) noexcept {
+  __libc_free(ptr);
+}
+}
+
+template <class T>
+inline void doNotOptimize(const T& value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+struct Measurement {
+  const char* name;
+  double nsPerOp;
+  double allocationsPerOp;
+};
+
+std::vector<Measurement> measurements;
+const char* filter = nullptr;
+
+/*
+Calls f until a run takes at least 200 ms and reports the last run.
+A call of f counts as opsPerCall operations.
+*/
+template <class F>
+void measure(const char* name, std::size_t opsPerCall, F f) {
+  if (filter && !strstr(name, filter)) return;
+  uint64_t iterations = 1;
+  while (true) {
+    uint64_t startAllocations = allocations;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; ++i) {
+      f();
+    }
+    double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    uint64_t allocated = allocations - startAllocations;
+    if (elapsed >= 200e6 || iterations >= (1ULL << 32)) {
+      double ops = static_cast<double>(iterations) * opsPerCall;
+      Measurement m = {name, elapsed / ops, allocated / ops};
+      measurements.push_back(m);
+      printf("%-48s %12.2f ns/op %10.4f allocs/op\n", m.name, m.nsPerOp, m.allocationsPerOp);
+      return;
+    }
+    iterations *= (elapsed < 20e6) ? 10 : 2;
+  }
+}
+
+// deterministic pseudo random numbers
+uint32_t nextRandom() {
+  static uint32_t state = 2463534242;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+void appendFrame(std::vector<uint8_t>* stream, VitoWiFiInternals::EnginePacketVS2* packet, bool badChecksum, std::size_t truncate) {
+  std::size_t start = stream->size();
+  stream->push_back(VitoWiFiInternals::ProtocolBytes.ACK);
+  stream->push_back(VitoWiFiInternals::ProtocolBytes.PACKETSTART);
+  for (std::size_t i = 0; i < packet->length(); ++i) {
+    stream->push_back((*packet)[i]);
+  }
+  stream->push_back(packet->checksum() + (badChecksum ? 1 : 0));
+  if (truncate > 0 && truncate < stream->size() - start) stream->resize(stream->size() - truncate);
+}
+
+/*
+Responses as they appear on the wire: ACK, then the packet. Read responses
+of 1 to 9 bytes with now and then a write response.
+The corrupted stream also has bad checksums, truncated frames and noise.
+*/
+std::vector<uint8_t> createStream(std::size_t frames, bool corrupted) {
+  std::vector<uint8_t> stream;
+  VitoWiFiInternals::EnginePacketVS2 packet;
+  uint8_t data[16];
+  for (std::size_t i = 0; i < frames; ++i) {
+    uint8_t length = 1 + nextRandom() % 9;
+    for (std::size_t j = 0; j < length; ++j) data[j] = nextRandom();
+    uint16_t address = nextRandom();
+    if (i % 10 == 9) {
+      packet.createPacket(VitoWiFi::PacketType::RESPONSE, VitoWiFi::FunctionCode::WRITE, 0, address, length);
+    } else {
+      packet.createPacket(VitoWiFi::PacketType::RESPONSE, VitoWiFi::FunctionCode::READ, 0, address, length, data);
+    }
+    uint32_t fault = corrupted ? nextRandom() % 8 : 7;
+    if (fault == 2) {
+      std::size_t noise = 1 + nextRandom() % 8;
+      for (std::size_t j = 0; j < noise; ++j) stream.push_back(nextRandom());
+    }
+    appendFrame(&stream, &packet, fault == 0, fault == 1 ? 1 + nextRandom() % 4 : 0);
+  }
+  return stream;
+}
+
+void packetBenchmarks() {
+  VitoWiFiInternals::EnginePacketVS2 packet;
+  uint8_t data[32];
+  for (std::size_t i = 0; i < sizeof(data); ++i) data[i] = i;
+
+  measure("PacketVS2::createPacket read request", 1, [&]() {
+    packet.createPacket(VitoWiFi::PacketType::REQUEST, VitoWiFi::FunctionCode::READ, 0, 0x00F8, 2);
+    doNotOptimize(packet.checksum());
+  });
+  measure("PacketVS2::createPacket write request, 4 bytes", 1, [&]() {
+    packet.createPacket(VitoWiFi::PacketType::REQUEST, VitoWiFi::FunctionCode::WRITE, 0, 0x2323, 4, data);
+    doNotOptimize(packet.checksum());
+  });
+  measure("PacketVS2::createPacket read response, 32 bytes", 1, [&]() {
+    packet.createPacket(VitoWiFi::PacketType::RESPONSE, VitoWiFi::FunctionCode::READ, 0, 0x7700, 32, data);
+    doNotOptimize(packet.checksum());
+  });
+  measure("PacketVS2 new packet + createPacket", 1, [&]() {
+    VitoWiFiInternals::EnginePacketVS2 fresh;
+    fresh.createPacket(VitoWiFi::PacketType::REQUEST, VitoWiFi::FunctionCode::READ, 0, 0x00F8, 2);
+    doNotOptimize(fresh.checksum());
+  });
+}
+
+void parserBenchmarks() {
+  const std::size_t frames = 1000;
+  std::vector<uint8_t> clean = createStream(frames, false);
+  std::vector<uint8_t> corrupted = createStream(frames, true);
+  printf("streams: %u frames, %u bytes clean, %u bytes corrupted\n",
+         static_cast<unsigned int>(frames), static_cast<unsigned int>(clean.size()),
+         static_cast<unsigned int>(corrupted.size()));
+  VitoWiFiInternals::ParserVS2 parser;
+
+  auto bytewise = [&parser](const std::vector<uint8_t>& stream) {
+    std::size_t complete = 0;
+    parser.reset();
+    for (std::size_t i = 0; i < stream.size(); ++i) {
+      if (parser.parse(stream[i]) == VitoWiFiInternals::ParserResult::COMPLETE) ++complete;
+    }
+    doNotOptimize(complete);
+  };
+  auto spans = [&parser](const std::vector<uint8_t>& stream) {
+    std::size_t complete = 0;
+    std::size_t offset = 0;
+    parser.reset();
+    while (offset < stream.size()) {
+      std::size_t consumed = 0;
+      if (parser.parse(&stream[offset], stream.size() - offset, &consumed) == VitoWiFiInternals::ParserResult::COMPLETE) {
+        ++complete;
+      }
+      offset += consumed;
+    }
+    doNotOptimize(complete);
+  };
+
+  measure("ParserVS2::parse(byte), clean, per byte", clean.size(), [&]() { bytewise(clean); });
+  measure("ParserVS2::parse(span), clean, per byte", clean.size(), [&]() { spans(clean); });
+  measure("ParserVS2::parse(byte), corrupted, per byte", corrupted.size(), [&]() { bytewise(corrupted); });
+  measure("ParserVS2::parse(span), corrupted, per byte", corrupted.size(), [&]() { spans(corrupted); });
+  measure("ParserVS2::parse(byte), clean, per frame", frames, [&]() { bytewise(clean); });
+}
+
+void converterBenchmarks() {
+  // called through the base class like Datapoint does
+  const VitoWiFi::Converter* converters[] = {&VitoWiFi::div10, &VitoWiFi::div2, &VitoWiFi::div3600, &VitoWiFi::noconv};
+  const char* decodeNames[] = {"Div10Convert::decode", "Div2Convert::decode", "Div3600Convert::decode", "NoconvConvert::decode"};
+  const char* encodeNames[] = {"Div10Convert::encode", "Div2Convert::encode", "Div3600Convert::encode", "NoconvConvert::encode"};
+  const uint8_t lengths[] = {2, 1, 4, 2};
+  uint8_t data[4] = {0x20, 0xB8, 0x01, 0x00};
+
+  for (std::size_t i = 0; i < 4; ++i) {
+    const VitoWiFi::Converter* converter = converters[i];
+    uint8_t length = lengths[i];
+    doNotOptimize(converter);
+    measure(decodeNames[i], 1, [&]() {
+      float value = converter->decode(data, length);
+      doNotOptimize(value);
+    });
+    VitoWiFi::VariantValue value = converter->decode(data, length);
+    measure(encodeNames[i], 1, [&]() {
+      converter->encode(data, length, value);
+      doNotOptimize(data);
+    });
+  }
+}
+
+void scheduleBenchmarks() {
+  const char* schedule = "7:30 8:30 15:00 23:50";
+  uint8_t encoded[8] = {};
+  char decoded[48];
+  measure("encodeSchedule", 1, [&]() {
+    doNotOptimize(VitoWiFi::encodeSchedule(schedule, encoded));
+  });
+  measure("decodeSchedule", 1, [&]() {
+    doNotOptimize(VitoWiFi::decodeSchedule(encoded, sizeof(encoded), decoded, sizeof(decoded)));
+  });
+}
+
+bool write(const char* output) {
+  FILE* file = fopen(output, "w");
+  if (!file) {
+    perror("Could not open output file");
+    return false;
+  }
+  fprintf(file, "[\n");
+  for (std::size_t i = 0; i < measurements.size(); ++i) {
+    const Measurement& m = measurements[i];
+    fprintf(file, "  {\"name\": \"%s\", \"nsPerOp\": %.3f, \"allocationsPerOp\": %.4f}%s\n",
+            m.name, m.nsPerOp, m.allocationsPerOp, i + 1 < measurements.size() ? "," : "");
+  }
+  fprintf(file, "]\n");
+  fclose(file);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  const char* output = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else {
+      printf("usage: %s [--filter TEXT] [--output FILE]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  packetBenchmarks();
+  parserBenchmarks();
+  converterBenchmarks();
+  scheduleBenchmarks();
+  if (output && !write(output)) return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}